@@ -1,144 +1,602 @@
 #include <algorithm>
-#include <vector>
-#include <deque>
+#include <array>
 #include <cmath>
-#include <iostream>
+#include <cstdint>
+#include <optional>
 
 #include "astar.hxx"
+#include "bucket_queue.hxx"
+#include "radix_heap.hxx"
 
 static
-auto get_neighbors(Map const& map, Location const& loc) {
+auto get_neighbors(std::size_t rows, std::size_t cols, Location const& loc) {
   std::array<Location, 4> neighbors;
   std::size_t num_neighbors = 0;
   if (loc.col > 0)
     neighbors[num_neighbors++] = {loc.row, loc.col - 1};
   if (loc.row > 0)
     neighbors[num_neighbors++] = {loc.row - 1, loc.col};
-  if (loc.col < map.cols - 1)
+  if (loc.col < cols - 1)
     neighbors[num_neighbors++] = {loc.row, loc.col + 1};
-  if (loc.row < map.rows - 1)
+  if (loc.row < rows - 1)
     neighbors[num_neighbors++] = {loc.row + 1, loc.col};
   return std::tuple{neighbors, num_neighbors};
 }
 
-struct HeapInsertor {
-  HeapInsertor(std::vector<WeightedLocation>& heap):
-    first_insert_{true},
-    heap_{heap}
-  {
-    iter_d_ = std::distance(heap_.begin(), heap_.end());
-    std::pop_heap(heap_.begin(), heap_.end(), std::greater<WeightedLocation>());
-  }
+namespace {
 
-  ~HeapInsertor() {
-    auto iter_ = heap_.begin();
-    std::advance(iter_, iter_d_);
-    if (first_insert_) {
-      heap_.pop_back();
-      return;
-    }
+// Above this many buckets Dial's queue spends more time skipping empty
+// buckets than a radix heap spends redistributing.
+constexpr weight_type max_buckets = 1 << 12;
 
-    do {
-      std::push_heap(heap_.begin(), iter_, std::greater<WeightedLocation>{});
-      if (iter_ == heap_.end())
-        break;
-      ++iter_;
-    } while (true);
-  }
+// The weights of each terrain layout, addressed by row-major cell index,
+// so that one search() serves both.
+struct NodeTerrain {
+  using cost_type = weight_type;
 
-  void push(WeightedLocation&& wl) {
-    if (first_insert_) {
-      heap_.back() = std::move(wl);
-      first_insert_ = false;
-    } else {
-      heap_.push_back(std::move(wl));
-    }
-  }
+  Map const& map;
 
-  void decrease(weight_type weight, std::vector<WeightedLocation>::iterator iter) {
-    iter->weight = weight;
-    std::push_heap(heap_.begin(), iter + 1, std::greater<WeightedLocation>{});
-  }
+  std::size_t rows() const noexcept { return map.rows; }
+  std::size_t cols() const noexcept { return map.cols; }
+  cost_type weight(std::uint32_t i) const noexcept { return map.nodes[i].weight; }
+};
+
+template <typename W>
+struct PackedTerrain {
+  using cost_type = typename PackedMap<W>::cost_type;
+
+  PackedMap<W> const& map;
 
-private:
-  bool first_insert_;
-  std::vector<WeightedLocation>& heap_;
-  std::size_t iter_d_;
+  std::size_t rows() const noexcept { return map.rows; }
+  std::size_t cols() const noexcept { return map.cols; }
+  cost_type weight(std::uint32_t i) const noexcept { return map.weights[i]; }
 };
 
-weight_type find_paths(Map map,
-                       Location const& start, Location const& finish) {
-  auto& cell = map[start.row][start.col];
-  cell.g = map[start.row][start.col].weight;
-  cell.h = mdist(start, finish);
+// A* with h = min_weight * (Manhattan distance), which never overestimates
+// and changes by at most min_weight from a cell to its neighbour.  The
+// heuristic is consistent, so priorities pop in non-decreasing order, a
+// cell is final when it is first popped, and the search ends at finish.
+template <typename Terrain, typename Queue, typename Trace>
+weight_type search(Terrain terrain, SearchState<typename Terrain::cost_type>& state,
+                   Location const& start, Location const& finish,
+                   weight_type min_weight, Queue& opened, Trace& trace) {
+  using cost_type = typename Terrain::cost_type;
+  auto const index = [cols = terrain.cols()](Location const& loc) {
+    return static_cast<std::uint32_t>(loc.row * cols + loc.col);
+  };
+  auto const h = [&finish, min_weight, &trace](Location const& loc) {
+    trace.heuristic();
+    return static_cast<cost_type>(min_weight * mdist(loc, finish));
+  };
 
-  std::vector<WeightedLocation> opened = {{cell.g + cell.h, start}};
-  // opened.reserve(std::max(map.rows, map.cols));
-  // opened.reserve(map.rows * map.cols);
+  auto const first = index(start);
+  state.reach(first, terrain.weight(first), first);
+  opened.push_or_decrease(first, state.g(first) + h(start));
+  trace.push(opened.size());
 
-  auto min_cost = std::numeric_limits<weight_type>::max();
-  
   while (!opened.empty()) {
-    auto& head = opened.front();
-    // auto weight = head.weight;
+    auto const head = opened.top().id;
+    opened.pop();
+    trace.pop();
 
-    auto loc = head.loc;
-    auto& cell = map[loc.row][loc.col];
+    // An entry a decrease left behind in a bucket queue or radix heap.
+    if (state.closed(head)) {
+      trace.stale(head);
+      continue;
+    }
+    state.close(head);
 
-    HeapInsertor insertor(opened);
+    auto const g = state.g(head);
+    trace.expand(head, g);
+    auto const loc = Location{head / terrain.cols(), head % terrain.cols()};
+    if (loc == finish)
+      return g;
 
-    if (loc == finish) {
-      min_cost = std::min(min_cost, cell.g);
-      continue;
+    auto [neighbors, num_neighbors] = get_neighbors(terrain.rows(), terrain.cols(), loc);
+    for (std::size_t i_neighbors = 0; i_neighbors < num_neighbors; ++i_neighbors) {
+      auto const& loc_neighbor = neighbors[i_neighbors];
+      auto const neighbor = index(loc_neighbor);
+      cost_type cost = g + terrain.weight(neighbor);
+      auto const previous = state.g(neighbor);
+      if (previous <= cost)
+        continue;
+      state.reach(neighbor, cost, head);
+      trace.relax(neighbor, head, cost, previous != SearchState<cost_type>::unreached);
+      opened.push_or_decrease(neighbor, cost + h(loc_neighbor));
+      trace.push(opened.size());
     }
+  }
+
+  return std::numeric_limits<weight_type>::max();
+}
+
+// Dijkstra from start until every finish is final: once a cell of cost g
+// pops, so is any cell already reached at cost g or less.  Finishes are
+// answered in the order given, and those still open when the search runs
+// dry are whatever it left them at.
+template <typename Terrain, typename Queue, typename Trace>
+void search(Terrain terrain, SearchState<typename Terrain::cost_type>& state,
+            Location const& start, Location const* finishes, std::size_t n,
+            weight_type* costs, Queue& opened, Trace& trace) {
+  using cost_type = typename Terrain::cost_type;
+  auto const index = [cols = terrain.cols()](Location const& loc) {
+    return static_cast<std::uint32_t>(loc.row * cols + loc.col);
+  };
+  auto const answer = [&](std::size_t k) {
+    auto const g = state.g(index(finishes[k]));
+    costs[k] = g == SearchState<cost_type>::unreached
+      ? std::numeric_limits<weight_type>::max() : g;
+  };
 
-    if (min_cost < cell.g) {
+  auto const first = index(start);
+  state.reach(first, terrain.weight(first), first);
+  opened.push_or_decrease(first, state.g(first));
+  trace.push(opened.size());
+
+  std::size_t next = 0;
+  while (!opened.empty()) {
+    auto const head = opened.top().id;
+    opened.pop();
+    trace.pop();
+
+    if (state.closed(head)) {
+      trace.stale(head);
       continue;
     }
+    state.close(head);
 
-    auto [neighbors, num_neighbors] = get_neighbors(map, loc);
+    auto const g = state.g(head);
+    trace.expand(head, g);
+    for (; next < n && state.g(index(finishes[next])) <= g; ++next)
+      answer(next);
+    if (next == n)
+      return;
+
+    auto const loc = Location{head / terrain.cols(), head % terrain.cols()};
+    auto [neighbors, num_neighbors] = get_neighbors(terrain.rows(), terrain.cols(), loc);
     for (std::size_t i_neighbors = 0; i_neighbors < num_neighbors; ++i_neighbors) {
-      auto const& loc_neighbor = neighbors[i_neighbors];
-      auto& neighbor = map[loc_neighbor.row][loc_neighbor.col];
-      weight_type cost = cell.g + neighbor.weight;
-      if (neighbor.closed && neighbor.g <= cost)
+      auto const neighbor = index(neighbors[i_neighbors]);
+      cost_type cost = g + terrain.weight(neighbor);
+      auto const previous = state.g(neighbor);
+      if (previous <= cost)
         continue;
+      state.reach(neighbor, cost, head);
+      trace.relax(neighbor, head, cost, previous != SearchState<cost_type>::unreached);
+      opened.push_or_decrease(neighbor, cost);
+      trace.push(opened.size());
+    }
+  }
+
+  for (; next < n; ++next)
+    answer(next);
+}
 
-      // if (neighbor.closed && neighbor.g == cost)
-      //   continue;
+// Bidirectional A* with the average of the two heuristics as potential.
+//
+// Costs here leave out the cell a side starts from: forward, the cells
+// after start up to and including the cell; backward, those after the cell
+// up to and including finish, so that a path through a cell both sides
+// have reached costs forward + backward, plus start's weight.  With
+// h_f = min_weight * (distance to finish) and h_b the same to start, the
+// potential (h_f - h_b) / 2 is consistent for the forward side and its
+// negation for the backward one, and both sides run Dijkstra on costs
+// reduced by it.  Keys are doubled to keep them whole, and shifted by
+// min_weight * (distance from start to finish) to keep them non-negative:
+// forward, 2 * cost + min_weight * (d(cell, finish) - d(cell, start) + d).
+// The sides expand in turn by lower top key, and the search ends once the
+// two top keys sum to 2 * (best + min_weight * d): no path that is cheaper
+// than best is left then.  Stale entries at the top only delay that.
+template <typename Terrain, typename Queue, typename Trace>
+weight_type search(Terrain terrain, SearchState<typename Terrain::cost_type>& forward,
+                   SearchState<typename Terrain::cost_type>& backward,
+                   Location const& start, Location const& finish,
+                   weight_type min_weight, Queue& forward_opened, Queue& backward_opened,
+                   Trace& trace) {
+  using cost_type = typename Terrain::cost_type;
+  auto constexpr unreached = SearchState<cost_type>::unreached;
+  auto const index = [cols = terrain.cols()](Location const& loc) {
+    return static_cast<std::uint32_t>(loc.row * cols + loc.col);
+  };
+
+  struct Side {
+    SearchState<cost_type>& state;
+    Queue& opened;
+    Location from;
+    Location towards;
+    // Whether a step adds the weight of the cell stepped to, or of the
+    // cell stepped from.
+    bool forward;
+  };
+  auto sides = std::array<Side, 2>{{
+    {forward, forward_opened, start, finish, true},
+    {backward, backward_opened, finish, start, false},
+  }};
+
+  auto const d = mdist(start, finish);
+  auto const key = [&](Side const& side, Location const& loc, cost_type cost) {
+    trace.heuristic();
+    return static_cast<cost_type>(
+      2 * cost + min_weight * (mdist(loc, side.towards) + d - mdist(loc, side.from)));
+  };
+  for (auto& side : sides) {
+    auto const i = index(side.from);
+    side.state.reach(i, 0, i);
+    side.opened.push_or_decrease(i, key(side, side.from, 0));
+    trace.push(side.opened.size());
+  }
 
-      if (neighbor.parent == loc)
+  auto best = start == finish ? cost_type{0} : unreached;
+  auto const expand = [&](Side& self, Side const& other) {
+    auto const head = self.opened.top().id;
+    self.opened.pop();
+    trace.pop();
+    if (self.state.closed(head)) {
+      trace.stale(head);
+      return;
+    }
+    self.state.close(head);
+
+    auto const g = self.state.g(head);
+    trace.expand(head, g);
+    auto const loc = Location{head / terrain.cols(), head % terrain.cols()};
+    auto [neighbors, num_neighbors] = get_neighbors(terrain.rows(), terrain.cols(), loc);
+    for (std::size_t i_neighbors = 0; i_neighbors < num_neighbors; ++i_neighbors) {
+      auto const& loc_neighbor = neighbors[i_neighbors];
+      auto const neighbor = index(loc_neighbor);
+      cost_type cost = g + terrain.weight(self.forward ? neighbor : head);
+      auto const previous = self.state.g(neighbor);
+      if (previous <= cost)
         continue;
+      self.state.reach(neighbor, cost, head);
+      trace.relax(neighbor, head, cost, previous != unreached);
+      self.opened.push_or_decrease(neighbor, key(self, loc_neighbor, cost));
+      trace.push(self.opened.size());
+      if (auto const rest = other.state.g(neighbor); rest != unreached)
+        best = std::min<cost_type>(best, cost + rest);
+    }
+  };
 
-      //if (neighbor.weight >= 100)
-      //  continue;
-
-      std::cerr << __func__ << ":" << __LINE__ << ": "
-                << "loc_neighbor[" << i_neighbors << "]= " << loc_neighbor
-                << "; cost= " << cost << '\n';
-      neighbor.g = cost;
-      neighbor.closed = false;
-      // neighbor.h = mdist(loc_neighbor, finish);
-      neighbor.h = neighbor.weight ? mdist(loc_neighbor, finish) : 0;
-
-      auto iter = opened.rbegin();
-      for (; iter != opened.rend(); ++iter) {
-        if (iter->loc == loc_neighbor) {
-          map[loc_neighbor].parent = loc;
-          insertor.decrease(neighbor.g + neighbor.h, iter.base() - 1);
-          // iter->weight = neighbor.g + neighbor.h;
-          break;
-        }
-      }
-      if (iter == opened.rend()) {
-        insertor.push({neighbor.g + neighbor.h, loc_neighbor});
-        // opened.push_back({loc_neighbor, neighbor.g + neighbor.h});
+  while (!forward_opened.empty() && !backward_opened.empty()) {
+    auto const f = forward_opened.top().priority;
+    auto const b = backward_opened.top().priority;
+    if (best != unreached && f + b >= 2 * (best + min_weight * d))
+      break;
+    if (f <= b)
+      expand(sides[0], sides[1]);
+    else
+      expand(sides[1], sides[0]);
+  }
+
+  if (best == unreached)
+    return std::numeric_limits<weight_type>::max();
+  return terrain.weight(index(start)) + best;
+}
+
+// Directions of travel.  A jump point search state is a cell and the
+// direction it was entered in, numbered cell * 4 + direction.
+enum Direction : std::uint32_t { left, up, right, down };
+
+constexpr bool vertical(Direction d) noexcept { return d == up || d == down; }
+
+// A* over jump points, for a 4-connected grid with weights on the cells.
+//
+// Of the paths that only differ in where they turn, it keeps the ones that
+// turn from vertical to horizontal as late as they can: a cell entered
+// vertically from p may turn towards h only if the cell beside p that way,
+// p + h, costs more than itself.  Otherwise going p, p + h, then down into
+// the same cell costs no more, and trading the turns along a path that way
+// ends in such a path at no extra cost.  So a cell entered vertically
+// mostly goes straight on, and one entered horizontally goes straight on or
+// turns only where a vertical run from it leads somewhere.  Runs of either
+// are scanned rather than queued, up to the next cell with another way
+// out: the finish, a forced turn, or a horizontal cell whose vertical runs
+// reach one.
+template <typename Terrain, typename Queue, typename Trace>
+weight_type jump(Terrain terrain, SearchState<typename Terrain::cost_type>& state,
+                 Location const& start, Location const& finish,
+                 weight_type min_weight, Queue& opened, Trace& trace) {
+  using cost_type = typename Terrain::cost_type;
+  auto const rows = terrain.rows();
+  auto const cols = terrain.cols();
+  auto const index = [cols](Location const& loc) {
+    return static_cast<std::uint32_t>(loc.row * cols + loc.col);
+  };
+  auto const weight = [&](Location const& loc) { return terrain.weight(index(loc)); };
+  // Moves loc one cell towards d, unless that leaves the grid.
+  auto const step = [rows, cols](Location& loc, Direction d) {
+    switch (d) {
+    case left: if (loc.col == 0) return false; --loc.col; return true;
+    case up: if (loc.row == 0) return false; --loc.row; return true;
+    case right: if (loc.col + 1 == cols) return false; ++loc.col; return true;
+    default: if (loc.row + 1 == rows) return false; ++loc.row; return true;
+    }
+  };
+  // Whether loc, entered from `from`, may turn towards h.
+  auto const forced = [&](Location from, Location const& loc, Direction h) {
+    auto to = loc;
+    return step(to, h) && step(from, h) && weight(from) > weight(loc);
+  };
+
+  struct Jump {
+    Location loc;
+    cost_type g;
+  };
+  // The next cell with another way out along a vertical run from loc, the
+  // cell having cost g.
+  auto const run_vertical = [&](Location loc, Direction d, cost_type g) -> std::optional<Jump> {
+    for (auto from = loc; step(loc, d); from = loc) {
+      g += weight(loc);
+      if (loc == finish || forced(from, loc, left) || forced(from, loc, right))
+        return Jump{loc, g};
+    }
+    return std::nullopt;
+  };
+  auto const run_horizontal = [&](Location loc, Direction d, cost_type g) -> std::optional<Jump> {
+    while (step(loc, d)) {
+      g += weight(loc);
+      if (loc == finish || run_vertical(loc, up, g) || run_vertical(loc, down, g))
+        return Jump{loc, g};
+    }
+    return std::nullopt;
+  };
+
+  auto const push = [&](std::optional<Jump> const& jump, Direction d, std::uint32_t parent) {
+    if (!jump)
+      return;
+    auto const id = index(jump->loc) * 4 + d;
+    auto const previous = state.g(id);
+    if (previous <= jump->g)
+      return;
+    state.reach(id, jump->g, parent);
+    trace.relax(id, parent, jump->g, previous != SearchState<cost_type>::unreached);
+    trace.heuristic();
+    opened.push_or_decrease(id, jump->g + static_cast<cost_type>(
+      min_weight * mdist(jump->loc, finish)));
+    trace.push(opened.size());
+  };
+  // Every successor of loc entered towards d, or of the start for none.
+  auto const expand = [&](Location const& loc, std::optional<Direction> d,
+                          cost_type g, std::uint32_t id) {
+    for (auto next : {left, up, right, down}) {
+      if (d && (next + 2) % 4 == *d)
+        continue;
+      if (d && vertical(*d) && !vertical(next) && next != *d) {
+        auto from = loc;
+        step(from, static_cast<Direction>((*d + 2) % 4));
+        if (!forced(from, loc, next))
+          continue;
       }
-      // std::push_heap(opened.begin(), iter, std::greater<WeightedLocation>());
+      push(vertical(next) ? run_vertical(loc, next, g) : run_horizontal(loc, next, g),
+           next, id);
     }
+  };
+
+  auto const g = static_cast<cost_type>(weight(start));
+  if (start == finish)
+    return g;
+  expand(start, std::nullopt, g, index(start) * 4);
+
+  while (!opened.empty()) {
+    auto const head = opened.top().id;
+    opened.pop();
+    trace.pop();
+    if (state.closed(head)) {
+      trace.stale(head);
+      continue;
+    }
+    state.close(head);
+    trace.expand(head, state.g(head));
+
+    auto const loc = Location{head / 4 / cols, head / 4 % cols};
+    if (loc == finish)
+      return state.g(head);
+    expand(loc, static_cast<Direction>(head % 4), state.g(head), head);
+  }
+
+  return std::numeric_limits<weight_type>::max();
+}
+
+// The open set asked for, or the one that suits the weight bounds for
+// OpenSet::Auto.  bounds.min is the heuristic's weight per step: 0 for
+// Dijkstra.
+OpenSet resolve(OpenSet open_set, WeightBounds const& bounds) {
+  if (open_set != OpenSet::Auto)
+    return open_set;
+  return bounds.max < max_buckets && bounds.max + bounds.min < max_buckets
+    ? OpenSet::Buckets : OpenSet::Radix;
+}
+
+// Hands run() state's open set of the kind asked for, emptied.  A bucket
+// queue gets enough buckets for one step under bounds: the priority of a
+// neighbour exceeds that of its cell by at most its weight plus the change
+// in h.
+template <typename Cost, typename Run>
+decltype(auto) with_open_set(SearchState<Cost>& state, OpenSet open_set,
+                             WeightBounds const& bounds, Run&& run) {
+  switch (open_set) {
+  case OpenSet::Buckets:
+    return run(state.buckets(bounds.max + bounds.min + 1));
+  case OpenSet::Radix:
+    return run(state.radix());
+  default:
+    return run(state.heap());
+  }
+}
 
-    cell.closed = true;
+template <typename Terrain, typename Trace>
+weight_type search(Terrain terrain, SearchState<typename Terrain::cost_type>& state,
+                   WeightBounds const& bounds,
+                   Location const& start, Location const& finish,
+                   OpenSet open_set, Algorithm algorithm, Trace& trace) {
+  auto const cells = terrain.rows() * terrain.cols();
+  switch (algorithm) {
+  case Algorithm::Bidirectional: {
+    auto& backward = state.reverse();
+    state.reset(cells);
+    backward.reset(cells);
+    // Keys are doubled costs.
+    auto const doubled = WeightBounds{2 * bounds.min, 2 * bounds.max};
+    switch (resolve(open_set, doubled)) {
+    case OpenSet::Buckets: {
+      auto const span = doubled.max + doubled.min + 1;
+      return search(terrain, state, backward, start, finish, bounds.min,
+                    state.buckets(span), backward.buckets(span), trace);
+    }
+    case OpenSet::Radix:
+      return search(terrain, state, backward, start, finish, bounds.min,
+                    state.radix(), backward.radix(), trace);
+    default:
+      return search(terrain, state, backward, start, finish, bounds.min,
+                    state.heap(), backward.heap(), trace);
+    }
+  }
+  case Algorithm::JumpPoint:
+    // A jump spans many cells: no bounded window of buckets holds the
+    // priorities it pushes.
+    state.reset(cells * 4);
+    open_set = open_set == OpenSet::Heap ? OpenSet::Heap : OpenSet::Radix;
+    return with_open_set(state, open_set, bounds, [&](auto& opened) {
+      return jump(terrain, state, start, finish, bounds.min, opened, trace);
+    });
+  default:
+    state.reset(cells);
+    return with_open_set(state, resolve(open_set, bounds), bounds, [&](auto& opened) {
+      return search(terrain, state, start, finish, bounds.min, opened, trace);
+    });
   }
+}
+
+}  // namespace
+
+WeightBounds weight_bounds(Map const& map) {
+  auto const* first = map.nodes.get();
+  auto const* last = first + map.rows * map.cols;
+  auto const [min, max] = std::minmax_element(
+    first, last,
+    [](Node const& lhs, Node const& rhs) { return lhs.weight < rhs.weight; });
+  return {min->weight, max->weight};
+}
+
+template <typename W>
+static WeightBounds packed_weight_bounds(PackedMap<W> const& map) {
+  auto const* first = map.weights.get();
+  auto const [min, max] = std::minmax_element(first, first + map.size());
+  return {*min, *max};
+}
 
-  return min_cost;
+WeightBounds weight_bounds(PackedMap<std::uint8_t> const& map) {
+  return packed_weight_bounds(map);
+}
+
+WeightBounds weight_bounds(PackedMap<std::uint16_t> const& map) {
+  return packed_weight_bounds(map);
+}
+
+template <typename Trace>
+weight_type find_paths(Map const& map, WeightBounds const& bounds,
+                       SearchState<weight_type>& state,
+                       Location const& start, Location const& finish, Trace& trace,
+                       OpenSet open_set, Algorithm algorithm) {
+  return search(NodeTerrain{map}, state, bounds, start, finish,
+                open_set, algorithm, trace);
+}
+
+template <typename Trace>
+weight_type find_paths(PackedMap<std::uint8_t> const& map, WeightBounds const& bounds,
+                       SearchState<std::uint32_t>& state,
+                       Location const& start, Location const& finish, Trace& trace,
+                       OpenSet open_set, Algorithm algorithm) {
+  return search(PackedTerrain<std::uint8_t>{map}, state, bounds,
+                start, finish, open_set, algorithm, trace);
+}
+
+template <typename Trace>
+weight_type find_paths(PackedMap<std::uint16_t> const& map, WeightBounds const& bounds,
+                       SearchState<std::uint32_t>& state,
+                       Location const& start, Location const& finish, Trace& trace,
+                       OpenSet open_set, Algorithm algorithm) {
+  return search(PackedTerrain<std::uint16_t>{map}, state, bounds,
+                start, finish, open_set, algorithm, trace);
+}
+
+#define INSTANTIATE_FIND_PATHS(Trace)                                              \
+  template weight_type find_paths(Map const&, WeightBounds const&,                 \
+                                  SearchState<weight_type>&,                       \
+                                  Location const&, Location const&, Trace&,        \
+                                  OpenSet, Algorithm);                             \
+  template weight_type find_paths(PackedMap<std::uint8_t> const&,                  \
+                                  WeightBounds const&,                             \
+                                  SearchState<std::uint32_t>&,                     \
+                                  Location const&, Location const&, Trace&,        \
+                                  OpenSet, Algorithm);                             \
+  template weight_type find_paths(PackedMap<std::uint16_t> const&,                 \
+                                  WeightBounds const&,                             \
+                                  SearchState<std::uint32_t>&,                     \
+                                  Location const&, Location const&, Trace&,        \
+                                  OpenSet, Algorithm)
+
+INSTANTIATE_FIND_PATHS(NoTrace);
+INSTANTIATE_FIND_PATHS(SearchStats);
+INSTANTIATE_FIND_PATHS(EventTrace);
+
+weight_type find_paths(Map const& map, WeightBounds const& bounds,
+                       SearchState<weight_type>& state,
+                       Location const& start, Location const& finish,
+                       OpenSet open_set, Algorithm algorithm) {
+  auto trace = NoTrace();
+  return find_paths(map, bounds, state, start, finish, trace, open_set, algorithm);
+}
+
+weight_type find_paths(PackedMap<std::uint8_t> const& map, WeightBounds const& bounds,
+                       SearchState<std::uint32_t>& state,
+                       Location const& start, Location const& finish,
+                       OpenSet open_set, Algorithm algorithm) {
+  auto trace = NoTrace();
+  return find_paths(map, bounds, state, start, finish, trace, open_set, algorithm);
+}
+
+weight_type find_paths(PackedMap<std::uint16_t> const& map, WeightBounds const& bounds,
+                       SearchState<std::uint32_t>& state,
+                       Location const& start, Location const& finish,
+                       OpenSet open_set, Algorithm algorithm) {
+  auto trace = NoTrace();
+  return find_paths(map, bounds, state, start, finish, trace, open_set, algorithm);
+}
+
+weight_type find_paths(Map const& map,
+                       Location const& start, Location const& finish,
+                       OpenSet open_set, Algorithm algorithm) {
+  auto state = SearchState<weight_type>();
+  return find_paths(map, weight_bounds(map), state, start, finish, open_set, algorithm);
+}
+
+weight_type find_paths(PackedMap<std::uint8_t> const& map,
+                       Location const& start, Location const& finish,
+                       OpenSet open_set, Algorithm algorithm) {
+  auto state = SearchState<std::uint32_t>();
+  return find_paths(map, weight_bounds(map), state, start, finish, open_set, algorithm);
+}
+
+weight_type find_paths(PackedMap<std::uint16_t> const& map,
+                       Location const& start, Location const& finish,
+                       OpenSet open_set, Algorithm algorithm) {
+  auto state = SearchState<std::uint32_t>();
+  return find_paths(map, weight_bounds(map), state, start, finish, open_set, algorithm);
+}
+
+void find_paths(Map const& map, WeightBounds const& bounds,
+                SearchState<weight_type>& state, Location const& start,
+                Location const* finishes, std::size_t n, weight_type* costs,
+                OpenSet open_set) {
+  auto trace = NoTrace();
+  if (n == 1) {
+    costs[0] = search(NodeTerrain{map}, state, bounds, start, finishes[0],
+                      open_set, Algorithm::AStar, trace);
+    return;
+  }
+  auto const dijkstra = WeightBounds{0, bounds.max};
+  state.reset(map.rows * map.cols);
+  with_open_set(state, resolve(open_set, dijkstra), dijkstra, [&](auto& opened) {
+    search(NodeTerrain{map}, state, start, finishes, n, costs, opened, trace);
+  });
 }
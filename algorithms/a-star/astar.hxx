@@ -1,20 +1,18 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <tuple>
 #include <limits>
 #include <memory>
+#include <type_traits>
+#include <utility>
 #include <ostream>
 #include <istream>
 
-#if 0
-#define DEBUG(x) x
-#else
-#define DEBUG(x)
-#endif
-
-#if 0
-#define TRACE(x) std::cerr << #x << x << std::endl
-#else
-#define TRACE(x)
-#endif
+#include "search_state.hxx"
+#include "trace.hxx"
 
 using weight_type = std::size_t;
 
@@ -57,12 +55,10 @@ struct WeightedLocation {
   }
 };
 
+// A cell of the terrain.  What a search writes per cell lives in a
+// SearchState.
 struct Node {
-  weight_type g = std::numeric_limits<weight_type>::max();
-  weight_type h = 0;
   weight_type weight = 0;
-  bool closed = false;
-  Location parent;
 };
 
 struct Map {
@@ -116,6 +112,80 @@ struct Map {
   }
 };
 
+// The same terrain with 8- or 16-bit weights, an eighth or a quarter of
+// the memory of a Map's.  Costs over it are 32 bits, which also shrinks
+// the SearchState a search writes from 24 to 16 bytes a cell: the cost of
+// any path explored, plus its heuristic, must stay below
+// SearchState<std::uint32_t>::unreached.
+template <typename W>
+struct PackedMap {
+  static_assert(std::is_same_v<W, std::uint8_t> || std::is_same_v<W, std::uint16_t>,
+                "packed weights are 8 or 16 bits");
+
+  using cost_type = std::uint32_t;
+
+  // Frees the weights, unless something else owns them.
+  struct Release {
+    std::shared_ptr<void const> owner;
+
+    void operator () (W* weights) const noexcept {
+      if (!owner)
+        delete[] weights;
+    }
+  };
+
+  std::size_t rows;
+  std::size_t cols;
+  std::unique_ptr<W[], Release> weights;
+
+  PackedMap(std::size_t rows_, std::size_t cols_):
+    rows{rows_},
+    cols{cols_},
+    weights{new W[size()](), Release{}}
+  {}
+
+  // Weights kept alive by owner, such as the pages of a mapped file.
+  PackedMap(std::size_t rows_, std::size_t cols_, W* weights_,
+            std::shared_ptr<void const> owner):
+    rows{rows_},
+    cols{cols_},
+    weights{weights_, Release{std::move(owner)}}
+  {}
+
+  // Packs the weights of map, which must fit W.
+  explicit PackedMap(Map const& map):
+    PackedMap(map.rows, map.cols)
+  {
+    for (std::size_t i = 0; i < size(); ++i) {
+      assert(map.nodes[i].weight <= std::numeric_limits<W>::max());
+      weights[i] = static_cast<W>(map.nodes[i].weight);
+    }
+  }
+
+  PackedMap(PackedMap const& other):
+    rows{other.rows},
+    cols{other.cols},
+    weights{new W[other.size()], Release{}}
+  {
+    std::copy_n(other.weights.get(), size(), weights.get());
+  }
+  PackedMap& operator = (PackedMap const& other) {
+    return *this = PackedMap(other);
+  }
+
+  PackedMap(PackedMap&&) = default;
+  PackedMap& operator = (PackedMap&&) = default;
+
+  std::size_t size() const noexcept { return rows * cols; }
+
+  W* operator [] (std::size_t row) noexcept {
+    return weights.get() + row * cols;
+  }
+  W const* operator [] (std::size_t row) const noexcept {
+    return weights.get() + row * cols;
+  }
+};
+
 template <typename T> constexpr T absdiff(T x, T y) {
 #if defined(__GNUC__) || defined(__clang__)
   T result;
@@ -131,5 +201,104 @@ constexpr auto mdist(Location start, Location finish) {
   return absdiff(start.row, finish.row) + absdiff(start.col, finish.col);
 }
 
-weight_type find_paths(Map, Location const&, Location const&);
+// How find_paths() keeps its open set.
+enum class OpenSet {
+  // Buckets when the map's weights are small enough, Radix otherwise.
+  Auto,
+  // IndexedHeap: a 4-ary heap with decrease-key, for any weights.
+  Heap,
+  // BucketQueue (Dial): O(1) per operation, one bucket per possible step
+  // of the path cost.
+  Buckets,
+  // RadixHeap: O(1) amortised per bit of weight_type, for any weights.
+  Radix,
+};
+
+// How find_paths() searches.
+enum class Algorithm {
+  // A* from start.
+  AStar,
+  // A* from both ends at once, meeting in the middle: about half the
+  // expansions when the frontier grows with its radius.  Uses
+  // state.reverse() for the backward half.
+  Bidirectional,
+  // A* over jump points.  Runs of cells where the path can only go straight
+  // on are scanned rather than queued, which pays on plateaus of equal
+  // weight.  state is indexed by cell * 4 + the direction the cell was
+  // entered in, and the open set is a radix heap unless Heap is asked for.
+  JumpPoint,
+};
+
+// The lightest and heaviest cell of a map, which pick and size the open
+// set of a search over it.  Finding them scans the whole map, so a caller
+// with many queries computes them once.
+struct WeightBounds {
+  weight_type min;
+  weight_type max;
+};
+
+WeightBounds weight_bounds(Map const&);
+WeightBounds weight_bounds(PackedMap<std::uint8_t> const&);
+WeightBounds weight_bounds(PackedMap<std::uint16_t> const&);
+
+// Cost of the cheapest path from start to finish, counting the weights of
+// every cell on it (start and finish included), or the largest weight_type
+// when there is none.  bounds must be weight_bounds(map).  The search
+// leaves its costs and parents in state, which is reset first and may be
+// reused for the next query: a query then costs the cells it touches.
+weight_type find_paths(Map const&, WeightBounds const& bounds,
+                       SearchState<weight_type>& state,
+                       Location const&, Location const&,
+                       OpenSet open_set = OpenSet::Auto,
+                       Algorithm algorithm = Algorithm::AStar);
+weight_type find_paths(PackedMap<std::uint8_t> const&, WeightBounds const& bounds,
+                       SearchState<std::uint32_t>& state,
+                       Location const&, Location const&,
+                       OpenSet open_set = OpenSet::Auto,
+                       Algorithm algorithm = Algorithm::AStar);
+weight_type find_paths(PackedMap<std::uint16_t> const&, WeightBounds const& bounds,
+                       SearchState<std::uint32_t>& state,
+                       Location const&, Location const&,
+                       OpenSet open_set = OpenSet::Auto,
+                       Algorithm algorithm = Algorithm::AStar);
+
+// The same, reporting what the search does to trace: one of the policies
+// in trace.hxx.  The overloads above pass NoTrace.
+template <typename Trace>
+weight_type find_paths(Map const&, WeightBounds const& bounds,
+                       SearchState<weight_type>& state,
+                       Location const&, Location const&, Trace& trace,
+                       OpenSet open_set = OpenSet::Auto,
+                       Algorithm algorithm = Algorithm::AStar);
+template <typename Trace>
+weight_type find_paths(PackedMap<std::uint8_t> const&, WeightBounds const& bounds,
+                       SearchState<std::uint32_t>& state,
+                       Location const&, Location const&, Trace& trace,
+                       OpenSet open_set = OpenSet::Auto,
+                       Algorithm algorithm = Algorithm::AStar);
+template <typename Trace>
+weight_type find_paths(PackedMap<std::uint16_t> const&, WeightBounds const& bounds,
+                       SearchState<std::uint32_t>& state,
+                       Location const&, Location const&, Trace& trace,
+                       OpenSet open_set = OpenSet::Auto,
+                       Algorithm algorithm = Algorithm::AStar);
+
+// The same with a SearchState of its own and the map scanned for its
+// bounds, for a one-off query.
+weight_type find_paths(Map const&, Location const&, Location const&,
+                       OpenSet open_set = OpenSet::Auto,
+                       Algorithm algorithm = Algorithm::AStar);
+weight_type find_paths(PackedMap<std::uint8_t> const&, Location const&, Location const&,
+                       OpenSet open_set = OpenSet::Auto,
+                       Algorithm algorithm = Algorithm::AStar);
+weight_type find_paths(PackedMap<std::uint16_t> const&, Location const&, Location const&,
+                       OpenSet open_set = OpenSet::Auto,
+                       Algorithm algorithm = Algorithm::AStar);
 
+// Costs from start to each of finishes[0..n) into costs[0..n), from one
+// search that stops once they are all final: A* for a single finish,
+// Dijkstra for more.  bounds must be weight_bounds(map).
+void find_paths(Map const&, WeightBounds const& bounds,
+                SearchState<weight_type>& state, Location const& start,
+                Location const* finishes, std::size_t n, weight_type* costs,
+                OpenSet open_set = OpenSet::Auto);
@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+
+#include "batch.hxx"
+#include "work_stealing.hxx"
+
+std::vector<weight_type> find_paths(simd::ThreadPool& pool, Map const& map,
+                                    std::vector<Query> const& queries,
+                                    OpenSet open_set) {
+  auto answers = std::vector<weight_type>(queries.size());
+  if (queries.empty())
+    return answers;
+
+  // Query numbers sorted by start: each run of one start is a group.
+  auto const index = [&map](Location const& loc) {
+    return loc.row * map.cols + loc.col;
+  };
+  auto order = std::vector<std::uint32_t>(queries.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](auto lhs, auto rhs) {
+    return index(queries[lhs][0]) < index(queries[rhs][0]);
+  });
+  auto groups = std::vector<std::uint32_t>{0};
+  for (std::uint32_t i = 1; i < order.size(); ++i) {
+    if (!(queries[order[i]][0] == queries[order[i - 1]][0]))
+      groups.push_back(i);
+  }
+  groups.push_back(static_cast<std::uint32_t>(order.size()));
+
+  struct Worker {
+    SearchState<weight_type> state;
+    std::vector<Location> finishes;
+    std::vector<weight_type> costs;
+  };
+  auto workers = std::vector<Worker>(pool.size());
+  auto const bounds = weight_bounds(map);
+
+  simd::for_each_stealing(pool, groups.size() - 1, [&](unsigned w, std::size_t group) {
+    auto& worker = workers[w];
+    auto const first = order.begin() + groups[group];
+    auto const last = order.begin() + groups[group + 1];
+
+    worker.finishes.clear();
+    for (auto it = first; it != last; ++it)
+      worker.finishes.push_back(queries[*it][1]);
+    worker.costs.resize(worker.finishes.size());
+
+    find_paths(map, bounds, worker.state, queries[*first][0],
+               worker.finishes.data(), worker.finishes.size(),
+               worker.costs.data(), open_set);
+
+    for (auto it = first; it != last; ++it)
+      answers[*it] = worker.costs[it - first];
+  });
+  return answers;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "astar.hxx"
+#include "thread_pool.hxx"
+
+// A query for the cost from its first location to its second.
+using Query = std::array<Location, 2>;
+
+// Costs of all queries over map, answers[i] for queries[i].
+//
+// Queries from the same start share one search, which answers all their
+// finishes (see find_paths() with several finishes).  Those searches are
+// spread over pool's workers, each with a SearchState of its own, and a
+// worker that runs out of them steals half of the busiest one's.
+std::vector<weight_type> find_paths(simd::ThreadPool& pool, Map const& map,
+                                    std::vector<Query> const& queries,
+                                    OpenSet open_set = OpenSet::Auto);
@@ -1,10 +1,23 @@
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 #include <benchmark/benchmark.h>
 
 #include "astar.hxx"
+#include "batch.hxx"
+#include "hub_labels.hxx"
+#include "loader.hxx"
+#include "perf_counters.hxx"
 
+// A free corridor along the top row and down the right column through a
+// field of expensive cells: the open set stays small, and the cost of a
+// query is mostly that of setting it up.  Reuse says whether the queries
+// share one SearchState.
+template <bool Reuse>
 static void FindPath_RightDown(benchmark::State& state) {
   std::size_t rows = state.range(0);
   std::size_t cols = state.range(1);
@@ -21,16 +34,357 @@ static void FindPath_RightDown(benchmark::State& state) {
   for (unsigned i = 0; i < map.rows; ++i) {
     map[i][map.cols - 1].weight = 0;
   }
-  
+
+  auto const bounds = weight_bounds(map);
+  auto search = SearchState<weight_type>();
+  perf::BenchmarkCounters counters(state);
+  for (auto _ : state) {
+    auto path = Reuse
+      ? find_paths(map, bounds, search, Location{0, 0}, Location{map.rows-1, map.cols-1})
+      : find_paths(map, Location{0, 0}, Location{map.rows-1, map.cols-1});
+    benchmark::DoNotOptimize(&path);
+    benchmark::ClobberMemory();
+  }
+}
+
+#define FIND_PATH_RIGHT_DOWN_BENCHMARK(Reuse)          \
+  BENCHMARK_TEMPLATE(FindPath_RightDown, Reuse)        \
+  ->Args({1000, 1000})                                 \
+  ->Args({100, 100})                                   \
+  ->Args({10, 10})
+
+FIND_PATH_RIGHT_DOWN_BENCHMARK(false);
+FIND_PATH_RIGHT_DOWN_BENCHMARK(true);
+
+// rows x cols of weights drawn uniformly from lightest..heaviest.
+static Map make_random(std::size_t rows, std::size_t cols,
+                       weight_type lightest = 1, weight_type heaviest = 9) {
+  auto map = Map(rows, cols);
+  std::mt19937 gen(14770);
+  std::uniform_int_distribution<weight_type> weight(lightest, heaviest);
+  for (std::size_t r = 0; r < map.rows; ++r) {
+    for (std::size_t c = 0; c < map.cols; ++c) {
+      map[r][c].weight = weight(gen);
+    }
+  }
+  return map;
+}
+
+// Corner to corner over uniform weights 1..9, with each open set: the
+// search frontier, and so the open set, spans the grid diagonal.
+template <OpenSet Q>
+static void FindPath_Random(benchmark::State& state) {
+  auto const map = make_random(state.range(0), state.range(1));
+  auto const bounds = weight_bounds(map);
+  auto search = SearchState<weight_type>();
+  perf::BenchmarkCounters counters(state);
+  for (auto _ : state) {
+    auto path = find_paths(map, bounds, search, Location{0, 0},
+                           Location{map.rows-1, map.cols-1}, Q);
+    benchmark::DoNotOptimize(&path);
+    benchmark::ClobberMemory();
+  }
+}
+
+#define FIND_PATH_RANDOM_BENCHMARK(Q)                  \
+  BENCHMARK_TEMPLATE(FindPath_Random, Q)               \
+  ->Args({1000, 1000})                                 \
+  ->Args({100, 100})                                   \
+  ->Unit(benchmark::kMillisecond)
+
+FIND_PATH_RANDOM_BENCHMARK(OpenSet::Heap);
+FIND_PATH_RANDOM_BENCHMARK(OpenSet::Buckets);
+FIND_PATH_RANDOM_BENCHMARK(OpenSet::Radix);
+
+// The same search over PackedMap<W>.
+template <typename W, OpenSet Q>
+static void FindPath_RandomPacked(benchmark::State& state) {
+  auto const map = PackedMap<W>(make_random(state.range(0), state.range(1)));
+  auto const bounds = weight_bounds(map);
+  auto search = SearchState<std::uint32_t>();
+  perf::BenchmarkCounters counters(state);
+  for (auto _ : state) {
+    auto path = find_paths(map, bounds, search, Location{0, 0},
+                           Location{map.rows-1, map.cols-1}, Q);
+    benchmark::DoNotOptimize(&path);
+    benchmark::ClobberMemory();
+  }
+}
+
+#define FIND_PATH_RANDOM_PACKED_BENCHMARK(W, Q)        \
+  BENCHMARK_TEMPLATE(FindPath_RandomPacked, W, Q)      \
+  ->Args({1000, 1000})                                 \
+  ->Args({100, 100})                                   \
+  ->Unit(benchmark::kMillisecond)
+
+FIND_PATH_RANDOM_PACKED_BENCHMARK(std::uint8_t, OpenSet::Heap);
+FIND_PATH_RANDOM_PACKED_BENCHMARK(std::uint8_t, OpenSet::Buckets);
+FIND_PATH_RANDOM_PACKED_BENCHMARK(std::uint8_t, OpenSet::Radix);
+FIND_PATH_RANDOM_PACKED_BENCHMARK(std::uint16_t, OpenSet::Buckets);
+
+// The Random search under each tracing policy: what recording costs.
+template <typename Trace>
+static void FindPath_Trace(benchmark::State& state) {
+  auto const map = make_random(state.range(0), state.range(1));
+  auto const bounds = weight_bounds(map);
+  auto search = SearchState<weight_type>();
+  auto trace = Trace();
+  perf::BenchmarkCounters counters(state);
+  for (auto _ : state) {
+    auto path = find_paths(map, bounds, search, Location{0, 0},
+                           Location{map.rows-1, map.cols-1}, trace);
+    benchmark::DoNotOptimize(&path);
+    benchmark::ClobberMemory();
+  }
+}
+
+#define FIND_PATH_TRACE_BENCHMARK(Trace)               \
+  BENCHMARK_TEMPLATE(FindPath_Trace, Trace)            \
+  ->Args({1000, 1000})                                 \
+  ->Args({100, 100})                                   \
+  ->Unit(benchmark::kMillisecond)
+
+FIND_PATH_TRACE_BENCHMARK(NoTrace);
+FIND_PATH_TRACE_BENCHMARK(SearchStats);
+FIND_PATH_TRACE_BENCHMARK(EventTrace);
+
+// stats, summed over the benchmark's iterations, as counters per query.
+static void report(benchmark::State& state, SearchStats const& stats) {
+  auto const per_query = [](std::size_t n) {
+    return benchmark::Counter(static_cast<double>(n), benchmark::Counter::kAvgIterations);
+  };
+  state.counters["expansions"] = per_query(stats.expansions);
+  state.counters["stale_pops"] = per_query(stats.stale_pops);
+  state.counters["relaxations"] = per_query(stats.relaxations);
+  state.counters["reopenings"] = per_query(stats.reopenings);
+  state.counters["heap_ops"] = per_query(stats.pushes + stats.pops);
+  state.counters["heuristics"] = per_query(stats.heuristic_evaluations);
+  state.counters["max_open"] = static_cast<double>(stats.max_open);
+}
+
+// Corner to corner over one weight: every cell of the grid lies on a
+// cheapest path, and the heuristic cannot tell them apart.
+template <Algorithm A>
+static void FindPath_Plateau(benchmark::State& state) {
+  std::size_t rows = state.range(0);
+  std::size_t cols = state.range(1);
+  auto map = Map(rows, cols);
+  for (std::size_t i = 0; i < rows * cols; ++i)
+    map.nodes[i].weight = 100;
+
+  auto const bounds = weight_bounds(map);
+  auto search = SearchState<weight_type>();
+  auto stats = SearchStats();
+  perf::BenchmarkCounters counters(state);
+  for (auto _ : state) {
+    auto path = find_paths(map, bounds, search, Location{0, 0},
+                           Location{map.rows-1, map.cols-1}, stats, OpenSet::Auto, A);
+    benchmark::DoNotOptimize(&path);
+    benchmark::ClobberMemory();
+  }
+  report(state, stats);
+}
+
+#define FIND_PATH_PLATEAU_BENCHMARK(A)                 \
+  BENCHMARK_TEMPLATE(FindPath_Plateau, A)              \
+  ->Args({1000, 1000})                                 \
+  ->Args({100, 100})                                   \
+  ->Unit(benchmark::kMicrosecond)
+
+FIND_PATH_PLATEAU_BENCHMARK(Algorithm::AStar);
+FIND_PATH_PLATEAU_BENCHMARK(Algorithm::Bidirectional);
+FIND_PATH_PLATEAU_BENCHMARK(Algorithm::JumpPoint);
+
+// The map and queries of an input file in main()'s format, or none when
+// it cannot be read.
+static Input read_file(char const* path) {
+  try {
+    return read_input(MappedFile(path).text());
+  } catch (std::runtime_error const&) {
+    return {};
+  }
+}
+
+// The queries of a committed input, one per iteration in turn, run from
+// this directory.
+static void FindPath_Input(benchmark::State& state, char const* path,
+                           Algorithm algorithm) {
+  auto const input = read_file(path);
+  if (input.queries.empty()) {
+    state.SkipWithError("cannot read the input");
+    return;
+  }
+
+  auto const bounds = weight_bounds(input.map);
+  auto search = SearchState<weight_type>();
+  auto stats = SearchStats();
+  std::size_t i = 0;
+  perf::BenchmarkCounters counters(state);
   for (auto _ : state) {
-    auto path = find_paths(map, Location{0, 0}, Location{map.rows-1, map.cols-1});
+    auto const& [start, finish] = input.queries[i++ % input.queries.size()];
+    auto path = find_paths(input.map, bounds, search, start, finish, stats,
+                           OpenSet::Auto, algorithm);
     benchmark::DoNotOptimize(&path);
+  }
+  report(state, stats);
+}
+
+#define FIND_PATH_INPUT_BENCHMARK(name, path)                                      \
+  BENCHMARK_CAPTURE(FindPath_Input, name##_astar, path, Algorithm::AStar);         \
+  BENCHMARK_CAPTURE(FindPath_Input, name##_bidirectional, path,                    \
+                    Algorithm::Bidirectional);                                     \
+  BENCHMARK_CAPTURE(FindPath_Input, name##_jump_point, path, Algorithm::JumpPoint)
+
+FIND_PATH_INPUT_BENCHMARK(map_simple, "map-simple.txt");
+FIND_PATH_INPUT_BENCHMARK(map_wall, "map-wall.txt");
+FIND_PATH_INPUT_BENCHMARK(map_edgecase, "map-edgecase.txt");
+FIND_PATH_INPUT_BENCHMARK(hr_14770_input0, "hr-14770-input0.txt");
+FIND_PATH_INPUT_BENCHMARK(hr_14770_input10, "hr-14770-input10.txt");
+
+// The input as main() read it before loader.hxx: cell by cell through
+// std::istream.
+static Input read_stream(char const* path) {
+  auto input = Input{};
+  auto is = std::ifstream(path);
+  std::size_t rows = 0, cols = 0, q = 0;
+  is >> rows >> cols;
+  input.map = Map(rows, cols);
+  for (std::size_t i = 0; i < rows * cols; ++i)
+    is >> input.map.nodes[i].weight;
+  is >> q;
+  input.queries.resize(q);
+  for (auto& [start, finish] : input.queries)
+    is >> start >> finish;
+  return input;
+}
+
+// A 1000x1000 map of weights 0..255 with 30000 queries, as text and as a
+// binary map, written once to the current directory.
+static char const* const square_text = "bench-square.txt";
+static char const* const square_map = "bench-square.map";
+
+static void write_square() {
+  static bool const written = [] {
+    std::mt19937 gen(14770);
+    std::uniform_int_distribution<weight_type> weight(0, 255);
+    std::uniform_int_distribution<std::size_t> coordinate(0, 999);
+    auto map = Map(1000, 1000);
+    auto os = std::ofstream(square_text);
+    os << map.rows << ' ' << map.cols << '\n';
+    for (std::size_t r = 0; r < map.rows; ++r) {
+      for (std::size_t c = 0; c < map.cols; ++c)
+        os << (map[r][c].weight = weight(gen)) << (c + 1 < map.cols ? ' ' : '\n');
+    }
+    os << 30000 << '\n';
+    for (int i = 0; i < 30000; ++i) {
+      os << coordinate(gen) << ' ' << coordinate(gen) << ' '
+         << coordinate(gen) << ' ' << coordinate(gen) << '\n';
+    }
+    auto bin = std::ofstream(square_map, std::ios::binary);
+    save_map(bin, map);
+    return true;
+  }();
+  static_cast<void>(written);
+}
+
+// The input at path, read by read.
+static void Load_Text(benchmark::State& state, char const* path,
+                      Input (*read)(char const*)) {
+  write_square();
+  perf::BenchmarkCounters counters(state);
+  for (auto _ : state) {
+    auto input = read(path);
+    benchmark::DoNotOptimize(input.map.nodes.get());
+    benchmark::DoNotOptimize(input.queries.data());
+  }
+}
+BENCHMARK_CAPTURE(Load_Text, hr_14770_input10_stream, "hr-14770-input10.txt", read_stream)
+->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(Load_Text, hr_14770_input10_mapped, "hr-14770-input10.txt", read_file)
+->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(Load_Text, square_stream, square_text, read_stream)
+->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(Load_Text, square_mapped, square_text, read_file)
+->Unit(benchmark::kMillisecond);
+
+// Maps the square's binary map, and reads every weight once: the pages
+// come in as the first search would touch them.
+static void Load_Binary(benchmark::State& state) {
+  write_square();
+  perf::BenchmarkCounters counters(state);
+  for (auto _ : state) {
+    auto map = std::get<PackedMap<std::uint8_t>>(load_map(square_map));
+    auto const* first = map.weights.get();
+    benchmark::DoNotOptimize(*std::max_element(first, first + map.size()));
+  }
+}
+BENCHMARK(Load_Binary)->Unit(benchmark::kMillisecond);
+
+// A long strip of weights 0..3, the shape of hr-14770-input10.txt.
+static Map make_strip() {
+  return make_random(7, 5000, 0, 3);
+}
+
+// 3000 queries over the strip from 1000 starts, answered on a pool of
+// range(0) workers.
+static void FindPaths_Batch(benchmark::State& state) {
+  auto const map = make_strip();
+  std::mt19937 gen(14770);
+  std::uniform_int_distribution<std::size_t> row(0, map.rows - 1);
+  std::uniform_int_distribution<std::size_t> col(0, map.cols - 1);
+  auto starts = std::vector<Location>(1000);
+  for (auto& start : starts)
+    start = Location{row(gen), col(gen)};
+  std::uniform_int_distribution<std::size_t> pick(0, starts.size() - 1);
+  auto queries = std::vector<Query>(3000);
+  for (auto& query : queries)
+    query = Query{starts[pick(gen)], Location{row(gen), col(gen)}};
+
+  simd::ThreadPool pool(static_cast<unsigned>(state.range(0)));
+  perf::BenchmarkCounters counters(state);
+  for (auto _ : state) {
+    auto costs = find_paths(pool, map, queries);
+    benchmark::DoNotOptimize(costs.data());
     benchmark::ClobberMemory();
   }
+  state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(FindPaths_Batch)
+->Arg(1)
+->Arg(2)
+->Arg(4)
+->Arg(8)
+->Unit(benchmark::kMillisecond)
+->UseRealTime();
+
+static void HubLabels_Build(benchmark::State& state) {
+  auto const map = make_strip();
+  perf::BenchmarkCounters counters(state);
+  for (auto _ : state) {
+    auto labels = HubLabels(map);
+    benchmark::DoNotOptimize(&labels);
+  }
+}
+BENCHMARK(HubLabels_Build)->Unit(benchmark::kMillisecond);
+
+static void HubLabels_Distance(benchmark::State& state) {
+  auto const map = make_strip();
+  auto const labels = HubLabels(map);
+  std::mt19937 gen(14770);
+  std::uniform_int_distribution<std::size_t> row(0, map.rows - 1);
+  std::uniform_int_distribution<std::size_t> col(0, map.cols - 1);
+  auto queries = std::vector<Query>(4096);
+  for (auto& query : queries)
+    query = Query{Location{row(gen), col(gen)}, Location{row(gen), col(gen)}};
+
+  std::size_t i = 0;
+  perf::BenchmarkCounters counters(state);
+  for (auto _ : state) {
+    auto const& [start, finish] = queries[i++ % queries.size()];
+    auto cost = labels.distance(start, finish);
+    benchmark::DoNotOptimize(cost);
+  }
 }
-BENCHMARK(FindPath_RightDown)
-->Args({1000, 1000})
-->Args({100, 100})
-->Args({10, 10});
+BENCHMARK(HubLabels_Distance);
 
 BENCHMARK_MAIN();
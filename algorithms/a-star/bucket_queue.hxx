@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Dial's monotone bucket queue for small integer priorities.
+//
+// Every queued priority must lie in [top().priority, top().priority + span),
+// and pushes may not go below the last popped priority: both hold for
+// Dijkstra, and for A* with a consistent heuristic, when span exceeds the
+// largest step of the priority from a cell to its neighbour.  A circular
+// array of `span` buckets then holds one priority per bucket, and push and
+// pop are O(1) plus the empty buckets skipped on the way up.
+//
+// Entries are not moved on a decrease: push_or_decrease() queues the id
+// again and the old entry is left behind.  It pops after the new one, and
+// the caller skips it (it has already closed the id).
+template <typename Priority>
+class BucketQueue {
+public:
+  using id_type = std::uint32_t;
+
+  struct Entry {
+    Priority priority;
+    id_type id;
+  };
+
+  explicit BucketQueue(std::size_t span):
+    buckets_(span)
+  {}
+
+  bool empty() const noexcept { return size_ == 0; }
+  std::size_t size() const noexcept { return size_; }
+
+  // Advances to the lowest non-empty bucket only here, so that a push after
+  // pop() may still go anywhere above the popped priority.
+  Entry const& top() noexcept {
+    while (bucket(current_).empty())
+      ++current_;
+    return bucket(current_).back();
+  }
+
+  void push_or_decrease(id_type id, Priority priority) {
+    assert(priority >= current_);
+    // Only the first push of a search lands beyond the window: move the
+    // window up to it.
+    if (priority - current_ >= buckets_.size()) {
+      assert(size_ == 0);
+      current_ = priority;
+    }
+    bucket(priority).push_back({priority, id});
+    ++size_;
+  }
+
+  // Pops the entry top() returned.
+  void pop() noexcept {
+    bucket(current_).pop_back();
+    --size_;
+  }
+
+  void clear() {
+    for (auto& bucket : buckets_)
+      bucket.clear();
+    size_ = 0;
+    current_ = 0;
+  }
+
+  // Empties the queue and gives it `span` buckets, reusing their storage.
+  void reset(std::size_t span) {
+    clear();
+    buckets_.resize(span);
+  }
+
+private:
+  std::vector<Entry>& bucket(Priority priority) noexcept {
+    return buckets_[priority % buckets_.size()];
+  }
+
+  std::vector<std::vector<Entry>> buckets_;
+  std::size_t size_ = 0;
+  Priority current_ = 0;
+};
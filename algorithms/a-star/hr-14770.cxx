@@ -230,10 +230,86 @@ get_neighbors(Map<Weight> const& a, Location const& loc) noexcept {
   return make_pair(neighbors, neighbors_i);
 }
 
+// The open sets below stay in this file so that it can be submitted on its
+// own: bucket_queue.hxx has the full Dial queue and radix_heap.hxx the
+// radix heap.  Both leave a stale entry behind when a cell's cost drops,
+// and shortest_paths() skips it when it pops.
+struct Entry {
+  Weight priority;
+  uint32_t id;
+};
+
+// Dial's queue: a ring of `span` buckets, one per priority, for Dijkstra
+// over weights below span.
+class BucketQueue {
+public:
+  explicit BucketQueue(size_t span): buckets_(span) {}
+
+  bool empty() const noexcept { return size_ == 0; }
+
+  Entry const& top() noexcept {
+    while (bucket(current_).empty())
+      ++current_;
+    return bucket(current_).back();
+  }
+
+  void push_or_decrease(uint32_t id, Weight priority) {
+    // The first push of a search may land past the window.
+    if (priority - current_ >= buckets_.size())
+      current_ = priority;
+    bucket(priority).push_back({priority, id});
+    ++size_;
+  }
+
+  void pop() noexcept {
+    bucket(current_).pop_back();
+    --size_;
+  }
+
+  void clear() noexcept {
+    for (auto& bucket : buckets_)
+      bucket.clear();
+    size_ = 0;
+    current_ = 0;
+  }
+
+private:
+  vector<Entry>& bucket(Weight priority) noexcept {
+    return buckets_[priority % buckets_.size()];
+  }
+
+  vector<vector<Entry>> buckets_;
+  size_t size_ = 0;
+  Weight current_ = 0;
+};
+
+// A binary heap, for weights too large for a bucket per priority.
+class LazyHeap {
+public:
+  bool empty() const noexcept { return heap_.empty(); }
+  Entry const& top() const noexcept { return heap_.top(); }
+  void push_or_decrease(uint32_t id, Weight priority) { heap_.push({priority, id}); }
+  void pop() { heap_.pop(); }
+  void clear() noexcept { heap_ = {}; }
+
+private:
+  struct Later {
+    bool operator () (Entry const& lhs, Entry const& rhs) const noexcept {
+      return lhs.priority > rhs.priority;
+    }
+  };
+
+  priority_queue<Entry, vector<Entry>, Later> heap_;
+};
+
+// Dijkstra from every distinct start, over a monotone open set (a
+// BucketQueue or LazyHeap) that leaves stale entries behind on decreases.
+template <typename OpenSet>
 [[gnu::optimize("O3")]]
 inline vector<int>
 shortest_paths(Map<Weight> const& a,
-               vector<array<Location, 2>> const& queries) {
+               vector<array<Location, 2>> const& queries,
+               OpenSet& opened) {
   auto answers = vector<int>(queries.size(), numeric_limits<int>::max());
   //auto highway = Map<WeightedLocation>(a.rows, a.cols);
   auto weights = Map<Weight>(a.rows, a.cols);
@@ -313,27 +389,30 @@ shortest_paths(Map<Weight> const& a,
     auto query_target = query_targets.cbegin();
     Location target = queries[*query_target][1];
 
-    vector<Location> opened = {{start}};
+    opened.clear();
+    opened.push_or_decrease(start.row * a.cols + start.col, getloc(a, start));
     while (!opened.empty()) {
-      auto const loc = opened.front();
-
-      pop_heap(opened.begin(), opened.end(), make_heap_cmp(weights));
-      opened.pop_back();
+      auto const [priority, head] = opened.top();
+      auto const loc = Location{head / a.cols, head % a.cols};
+      opened.pop();
 
       D(std::cerr << "loc= " << loc << '\n');
 
       auto const w = getloc(weights, loc);
+      if (priority != w)
+        continue;
       if (loc == target) {
         D(std::cerr << "target= " << target << '\n');
         answers[*query_target] = w;
         while (++query_target != query_targets.cend()) {
           target = queries[*query_target][1];
           D(std::cerr << "target= " << target << '\n');
-          auto const w = getloc(weights, target);
-          if (w == numeric_limits<Weight>::max())
+          auto const target_cost = getloc(weights, target);
+          // Final only once nothing still queued can undercut it.
+          if (target_cost > w)
             goto continue_grouped_query;
           else
-            answers[*query_target] = w;
+            answers[*query_target] = target_cost;
         }
         if (query_target == query_targets.cend()) {
           goto exit_grouped_query;
@@ -354,14 +433,7 @@ continue_grouped_query:
           continue;
 
         current_cost = new_cost;
-
-        auto iter = opened.rbegin();
-        for (; iter != opened.rend() && !(*iter == neighbor); ++iter);
-        if (iter == opened.rend()) {
-          opened.push_back(neighbor);
-          iter = opened.rbegin();
-        }
-        push_heap(opened.begin(), iter.base(), make_heap_cmp(weights));
+        opened.push_or_decrease(neighbor.row * a.cols + neighbor.col, new_cost);
       }
     }
 
@@ -377,6 +449,21 @@ exit_grouped_query: ;
   return answers;
 }
 
+inline vector<int>
+shortest_paths(Map<Weight> const& a,
+               vector<array<Location, 2>> const& queries) {
+  auto const max_weight =
+    *max_element(a.nodes.get(), a.nodes.get() + a.rows * a.cols);
+  // A Dijkstra priority exceeds the last popped one by at most max_weight,
+  // so max_weight + 1 buckets suffice while that stays small.
+  if (max_weight < (1 << 12)) {
+    auto opened = BucketQueue(max_weight + 1);
+    return shortest_paths(a, queries, opened);
+  }
+  auto opened = LazyHeap();
+  return shortest_paths(a, queries, opened);
+}
+
 int main(int, char**) {
   ios::sync_with_stdio(false);
   cin.tie(nullptr);
@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "hub_labels.hxx"
+#include "radix_heap.hxx"
+
+namespace {
+
+// "HUBL" in a little-endian image; reads back byte-swapped on a host of
+// the other order, which load() then rejects.
+constexpr std::uint32_t magic = 0x4c425548;
+constexpr std::uint32_t version = 1;
+
+// The cells [row0, row1) x [col0, col1).
+struct Region {
+  std::size_t row0;
+  std::size_t row1;
+  std::size_t col0;
+  std::size_t col1;
+
+  bool empty() const noexcept { return row0 >= row1 || col0 >= col1; }
+  std::size_t rows() const noexcept { return row1 - row0; }
+  std::size_t cols() const noexcept { return col1 - col0; }
+};
+
+// The middle column of a region at least as wide as it is tall, or else
+// its middle row.
+struct Cut {
+  bool column;
+  std::size_t line;
+
+  explicit Cut(Region const& region) noexcept:
+    column{region.cols() >= region.rows()},
+    line{column ? (region.col0 + region.col1) / 2
+                : (region.row0 + region.row1) / 2}
+  {}
+
+  std::size_t length(Region const& region) const noexcept {
+    return column ? region.rows() : region.cols();
+  }
+  // The k-th cell of the separator.
+  Location hub(Region const& region, std::size_t k) const noexcept {
+    return column ? Location{region.row0 + k, line} : Location{line, region.col0 + k};
+  }
+  // -1 before the separator, 0 on it, 1 past it.
+  int side(Location const& loc) const noexcept {
+    auto const x = column ? loc.col : loc.row;
+    return (x > line) - (x < line);
+  }
+  Region half(Region region, int side) const noexcept {
+    auto [first, last] = column ? std::tie(region.col0, region.col1)
+                                 : std::tie(region.row0, region.row1);
+    if (side < 0)
+      last = line;
+    else
+      first = line + 1;
+    return region;
+  }
+};
+
+// Calls fn(region, cut, base) for region and every region below it, base
+// being the position of the region's separator costs within the label of
+// each of its cells.
+template <typename Fn>
+void for_each_region(Region const& region, std::size_t base, Fn&& fn) {
+  if (region.empty())
+    return;
+  auto const cut = Cut(region);
+  fn(region, cut, base);
+  base += cut.length(region);
+  for_each_region(cut.half(region, -1), base, fn);
+  for_each_region(cut.half(region, 1), base, fn);
+}
+
+}  // namespace
+
+HubLabels::HubLabels(std::size_t rows, std::size_t cols):
+  rows_{rows},
+  cols_{cols},
+  weights_{std::make_unique<weight_type[]>(rows * cols)},
+  offsets_{std::make_unique<std::size_t[]>(rows * cols + 1)}
+{
+  // The layout depends on the shape alone: every cell has an entry per
+  // separator cell of every region it lies in.
+  for_each_region(Region{0, rows_, 0, cols_}, 0,
+                  [this](Region const& region, Cut const& cut, std::size_t) {
+    for (auto r = region.row0; r < region.row1; ++r) {
+      for (auto c = region.col0; c < region.col1; ++c)
+        offsets_[r * cols_ + c + 1] += cut.length(region);
+    }
+  });
+  std::partial_sum(&offsets_[0], &offsets_[rows_ * cols_ + 1], &offsets_[0]);
+  costs_ = std::make_unique<weight_type[]>(size());
+}
+
+HubLabels::HubLabels(Map const& map):
+  HubLabels(map.rows, map.cols)
+{
+  for (std::size_t i = 0; i < rows_ * cols_; ++i)
+    weights_[i] = map.nodes[i].weight;
+
+  // Dijkstra within each region from each of its separator cells.
+  auto costs = std::vector<weight_type>(rows_ * cols_);
+  auto opened = RadixHeap<weight_type>();
+  for_each_region(Region{0, rows_, 0, cols_}, 0,
+                  [&](Region const& region, Cut const& cut, std::size_t base) {
+    auto const width = region.cols();
+    auto const local = [&](std::size_t r, std::size_t c) {
+      return static_cast<std::uint32_t>((r - region.row0) * width + (c - region.col0));
+    };
+
+    for (std::size_t k = 0; k < cut.length(region); ++k) {
+      auto const hub = cut.hub(region, k);
+      std::fill_n(costs.begin(), region.rows() * width,
+                  std::numeric_limits<weight_type>::max());
+      costs[local(hub.row, hub.col)] = weights_[hub.row * cols_ + hub.col];
+      opened.clear();
+      opened.push_or_decrease(local(hub.row, hub.col), costs[local(hub.row, hub.col)]);
+
+      while (!opened.empty()) {
+        auto const [cost, head] = opened.top();
+        opened.pop();
+        if (cost != costs[head])
+          continue;
+
+        auto const r = region.row0 + head / width;
+        auto const c = region.col0 + head % width;
+        auto const relax = [&](std::size_t nr, std::size_t nc) {
+          auto const next = local(nr, nc);
+          auto const next_cost = cost + weights_[nr * cols_ + nc];
+          if (next_cost < costs[next]) {
+            costs[next] = next_cost;
+            opened.push_or_decrease(next, next_cost);
+          }
+        };
+        if (c > region.col0)
+          relax(r, c - 1);
+        if (r > region.row0)
+          relax(r - 1, c);
+        if (c + 1 < region.col1)
+          relax(r, c + 1);
+        if (r + 1 < region.row1)
+          relax(r + 1, c);
+      }
+
+      for (auto r = region.row0; r < region.row1; ++r) {
+        for (auto c = region.col0; c < region.col1; ++c)
+          costs_[offsets_[r * cols_ + c] + base + k] = costs[local(r, c)];
+      }
+    }
+  });
+}
+
+weight_type HubLabels::distance(Location const& start,
+                                Location const& finish) const noexcept {
+  auto const* lhs = &costs_[offsets_[start.row * cols_ + start.col]];
+  auto const* rhs = &costs_[offsets_[finish.row * cols_ + finish.col]];
+  auto best = std::numeric_limits<weight_type>::max();
+
+  // Down the regions that hold both ends, the first ones in their labels.
+  auto region = Region{0, rows_, 0, cols_};
+  for (;;) {
+    auto const cut = Cut(region);
+    auto const length = cut.length(region);
+    for (std::size_t k = 0; k < length; ++k) {
+      auto const hub = cut.hub(region, k);
+      // Both costs count the hub.
+      best = std::min(best, lhs[k] + rhs[k] - weights_[hub.row * cols_ + hub.col]);
+    }
+
+    auto const side = cut.side(start);
+    if (side == 0 || side != cut.side(finish))
+      return best;
+    region = cut.half(region, side);
+    lhs += length;
+    rhs += length;
+  }
+}
+
+bool HubLabels::matches(Map const& map) const noexcept {
+  if (map.rows != rows_ || map.cols != cols_)
+    return false;
+  for (std::size_t i = 0; i < rows_ * cols_; ++i) {
+    if (map.nodes[i].weight != weights_[i])
+      return false;
+  }
+  return true;
+}
+
+void HubLabels::save(std::ostream& os) const {
+  auto const write = [&os](void const* data, std::size_t bytes) {
+    os.write(static_cast<char const*>(data), static_cast<std::streamsize>(bytes));
+  };
+  std::uint64_t const shape[] = {rows_, cols_};
+  write(&magic, sizeof(magic));
+  write(&version, sizeof(version));
+  write(shape, sizeof(shape));
+  write(weights_.get(), rows_ * cols_ * sizeof(weight_type));
+  write(costs_.get(), size() * sizeof(weight_type));
+  if (!os)
+    throw std::runtime_error("hub labels: write failed");
+}
+
+HubLabels HubLabels::load(std::istream& is) {
+  auto const read = [&is](void* data, std::size_t bytes) {
+    is.read(static_cast<char*>(data), static_cast<std::streamsize>(bytes));
+    if (!is)
+      throw std::runtime_error("hub labels: truncated image");
+  };
+  std::uint32_t header[2];
+  std::uint64_t shape[2];
+  read(header, sizeof(header));
+  if (header[0] != magic || header[1] != version)
+    throw std::runtime_error("hub labels: not an image of this version");
+  read(shape, sizeof(shape));
+  if (shape[0] == 0 || shape[1] == 0 || shape[0] > not_in_heap / shape[1])
+    throw std::runtime_error("hub labels: bad shape");
+
+  auto labels = HubLabels(shape[0], shape[1]);
+  read(labels.weights_.get(), labels.rows_ * labels.cols_ * sizeof(weight_type));
+  read(labels.costs_.get(), labels.size() * sizeof(weight_type));
+  return labels;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <ostream>
+
+#include "astar.hxx"
+
+// Exact distance labels for a fixed Map, for answering many queries over
+// terrain that never changes.
+//
+// The map is cut in two across its longer side by a separator line, and
+// both halves likewise, down to single lines.  Every cell stores its cost
+// to each separator cell of each region it lies in, within that region.
+// A cheapest path crosses the separator of the smallest region holding all
+// of it, so a query is a min over the separators of the regions its ends
+// share: two label scans, no search.
+//
+// A cell lies in about log2(long side) regions, each with a separator of at
+// most the short side, and building runs one Dijkstra over each region
+// from each separator cell: meant for narrow maps such as hr-14770's 7x5000
+// strip, not for square ones.
+class HubLabels {
+public:
+  explicit HubLabels(Map const& map);
+
+  // Cost of the cheapest path from start to finish, as find_paths() counts
+  // it.
+  weight_type distance(Location const& start, Location const& finish) const noexcept;
+
+  // Whether these are the labels of map.
+  bool matches(Map const& map) const noexcept;
+
+  std::size_t rows() const noexcept { return rows_; }
+  std::size_t cols() const noexcept { return cols_; }
+  // Number of (separator cell, cost) entries over all labels.
+  std::size_t size() const noexcept { return offsets_[rows_ * cols_]; }
+
+  // A binary image in the host's byte order, for load() to read back
+  // instead of building again.  Both throw std::runtime_error on a failed
+  // stream or an image that is not one.
+  void save(std::ostream& os) const;
+  static HubLabels load(std::istream& is);
+
+private:
+  HubLabels(std::size_t rows, std::size_t cols);
+
+  std::size_t rows_;
+  std::size_t cols_;
+  std::unique_ptr<weight_type[]> weights_;
+  // Label of cell i: costs_[offsets_[i] .. offsets_[i + 1]).
+  std::unique_ptr<std::size_t[]> offsets_;
+  std::unique_ptr<weight_type[]> costs_;
+};
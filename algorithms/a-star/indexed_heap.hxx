@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Position of an id that is not in any heap.
+inline constexpr std::uint32_t not_in_heap =
+  std::numeric_limits<std::uint32_t>::max();
+
+// A d-ary min-heap of ids ordered by priority, with decrease-key.
+//
+// The heap does not own the id -> position map: `positions(id)` returns a
+// reference to a std::uint32_t slot stored with the id's other data (its
+// grid cell), which holds the id's index in the heap or not_in_heap.  Slots
+// must start out as not_in_heap; pop() and clear() reset them.
+//
+// With four children per node the heap is half as deep as a binary one,
+// and the children of a node share a cache line.
+template <typename Priority, typename Positions, std::size_t Arity = 4>
+class IndexedHeap {
+public:
+  using id_type = std::uint32_t;
+
+  struct Entry {
+    Priority priority;
+    id_type id;
+  };
+
+  explicit IndexedHeap(Positions positions):
+    positions_{std::move(positions)}
+  {}
+
+  bool empty() const noexcept { return heap_.empty(); }
+  std::size_t size() const noexcept { return heap_.size(); }
+  void reserve(std::size_t n) { heap_.reserve(n); }
+
+  Entry const& top() const noexcept { return heap_.front(); }
+
+  // Inserts `id`, or lowers its priority when it is already queued with a
+  // higher one.  Returns whether the heap changed.
+  bool push_or_decrease(id_type id, Priority priority) {
+    auto& pos = positions_(id);
+    if (pos == not_in_heap) {
+      pos = static_cast<id_type>(heap_.size());
+      heap_.push_back({priority, id});
+    } else if (priority < heap_[pos].priority) {
+      heap_[pos].priority = priority;
+    } else {
+      return false;
+    }
+    sift_up(pos);
+    return true;
+  }
+
+  void pop() {
+    positions_(heap_.front().id) = not_in_heap;
+    auto const last = heap_.back();
+    heap_.pop_back();
+    if (!heap_.empty())
+      sift_down(0, last);
+  }
+
+  void clear() {
+    for (auto const& entry : heap_)
+      positions_(entry.id) = not_in_heap;
+    heap_.clear();
+  }
+
+  // Empties the heap without touching the slots of the ids still in it, and
+  // takes its positions from `positions` from now on: for a caller that
+  // invalidates the old slots wholesale.
+  void reset(Positions positions) {
+    positions_ = std::move(positions);
+    heap_.clear();
+  }
+
+private:
+  // Both sifts move a hole rather than swapping, writing the sifted entry
+  // and its position once at the end.
+  void sift_up(std::size_t i) {
+    auto const entry = heap_[i];
+    while (i > 0) {
+      auto const parent = (i - 1) / Arity;
+      if (!(entry.priority < heap_[parent].priority))
+        break;
+      place(i, heap_[parent]);
+      i = parent;
+    }
+    place(i, entry);
+  }
+
+  void sift_down(std::size_t i, Entry const entry) {
+    auto const n = heap_.size();
+    for (;;) {
+      auto const first = i * Arity + 1;
+      if (first >= n)
+        break;
+      auto const last = std::min(first + Arity, n);
+      auto best = first;
+      for (auto child = first + 1; child < last; ++child) {
+        if (heap_[child].priority < heap_[best].priority)
+          best = child;
+      }
+      if (!(heap_[best].priority < entry.priority))
+        break;
+      place(i, heap_[best]);
+      i = best;
+    }
+    place(i, entry);
+  }
+
+  void place(std::size_t i, Entry const& entry) {
+    heap_[i] = entry;
+    positions_(entry.id) = static_cast<id_type>(i);
+  }
+
+  Positions positions_;
+  std::vector<Entry> heap_;
+};
+
+template <typename Priority, std::size_t Arity = 4, typename Positions>
+auto make_indexed_heap(Positions positions) {
+  return IndexedHeap<Priority, Positions, Arity>{std::move(positions)};
+}
@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "loader.hxx"
+
+namespace {
+
+// "AMAP" in a little-endian image; reads back byte-swapped on a host of
+// the other order, which load_map() then rejects.
+constexpr std::uint32_t magic = 0x50414d41;
+constexpr std::uint32_t version = 1;
+
+struct Header {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t width;
+  std::uint32_t reserved;
+  std::uint64_t rows;
+  std::uint64_t cols;
+};
+static_assert(sizeof(Header) == 32);
+
+[[noreturn]] void fail(char const* what) {
+  throw std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+}
+
+std::uint64_t parse(char const* first, char const* last) noexcept {
+  std::uint64_t value = 0;
+  for (; first != last; ++first)
+    value = value * 10 + static_cast<std::uint64_t>(*first - '0');
+  return value;
+}
+
+bool digit(char c) noexcept { return c >= '0' && c <= '9'; }
+
+}  // namespace
+
+MappedFile::MappedFile(char const* path) {
+  auto const fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    fail(path);
+  try {
+    open(fd);
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+}
+
+MappedFile::MappedFile(int fd) {
+  open(fd);
+}
+
+void MappedFile::open(int fd) {
+  struct stat st;
+  if (::fstat(fd, &st) != 0)
+    fail("fstat");
+  if (S_ISREG(st.st_mode)) {
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ == 0)
+      return;
+    auto* const data = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      data_ = static_cast<char*>(data);
+      mapped_ = true;
+      ::madvise(data, size_, MADV_SEQUENTIAL);
+      return;
+    }
+  }
+  // Not a file, or not one we may map: read it to the end.
+  buffer_.resize(1 << 16);
+  std::size_t size = 0;
+  for (;;) {
+    if (size == buffer_.size())
+      buffer_.resize(2 * size);
+    auto const n = ::read(fd, buffer_.data() + size, buffer_.size() - size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      fail("read");
+    if (n == 0)
+      break;
+    size += static_cast<std::size_t>(n);
+  }
+  buffer_.resize(size);
+  data_ = buffer_.data();
+  size_ = size;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept:
+  data_{std::exchange(other.data_, nullptr)},
+  size_{std::exchange(other.size_, 0)},
+  mapped_{std::exchange(other.mapped_, false)},
+  buffer_{std::move(other.buffer_)}
+{}
+
+MappedFile& MappedFile::operator = (MappedFile&& other) noexcept {
+  std::swap(data_, other.data_);
+  std::swap(size_, other.size_);
+  std::swap(mapped_, other.mapped_);
+  std::swap(buffer_, other.buffer_);
+  return *this;
+}
+
+MappedFile::~MappedFile() {
+  if (mapped_)
+    ::munmap(data_, size_);
+}
+
+std::size_t Scanner::read(std::uint64_t* out, std::size_t n) noexcept {
+  std::size_t count = 0;
+#if defined(__AVX2__)
+  auto const zero = _mm256_set1_epi8('0');
+  auto const nine = _mm256_set1_epi8(9);
+  while (count < n && end_ - p_ >= 32) {
+    auto const bytes = _mm256_sub_epi8(
+      _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p_)), zero);
+    auto const digits = _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, nine), bytes);
+    auto const mask = static_cast<std::uint64_t>(
+      static_cast<std::uint32_t>(_mm256_movemask_epi8(digits)));
+
+    // A run up to the end of the block may go on in the next one: the next
+    // block starts at it, or for a run of 32 digits, it is finished here.
+    std::size_t advance = 32;
+    for (auto bits = mask; bits;) {
+      auto const start = static_cast<unsigned>(__builtin_ctzll(bits));
+      auto const length = static_cast<unsigned>(__builtin_ctzll(~(mask >> start)));
+      if (start + length == 32) {
+        advance = start;
+        break;
+      }
+      out[count++] = parse(p_ + start, p_ + start + length);
+      if (count == n) {
+        p_ += start + length;
+        return count;
+      }
+      bits &= ~(((std::uint64_t{1} << length) - 1) << start);
+    }
+    p_ += advance;
+    if (advance == 0)
+      count += read_scalar(out + count, 1);
+  }
+#endif
+  return count + read_scalar(out + count, n - count);
+}
+
+std::size_t Scanner::read_scalar(std::uint64_t* out, std::size_t n) noexcept {
+  std::size_t count = 0;
+  for (; count < n; ++count) {
+    while (p_ != end_ && !digit(*p_))
+      ++p_;
+    if (p_ == end_)
+      break;
+    auto const first = p_;
+    while (p_ != end_ && digit(*p_))
+      ++p_;
+    out[count] = parse(first, p_);
+  }
+  return count;
+}
+
+std::uint64_t Scanner::next() {
+  std::uint64_t value;
+  if (read_scalar(&value, 1) != 1)
+    throw std::runtime_error("input: ends early");
+  return value;
+}
+
+Map read_map(Scanner& scanner) {
+  auto const rows = scanner.next();
+  auto const cols = scanner.next();
+  auto map = Map(rows, cols);
+  // Through a buffer that stays in L1.
+  std::uint64_t values[4096];
+  for (std::size_t i = 0; i < rows * cols;) {
+    auto const n = std::min<std::size_t>(std::size(values), rows * cols - i);
+    if (scanner.read(values, n) != n)
+      throw std::runtime_error("input: ends early");
+    for (std::size_t k = 0; k < n; ++k)
+      map.nodes[i + k].weight = values[k];
+    i += n;
+  }
+  return map;
+}
+
+std::vector<Query> read_queries(Scanner& scanner) {
+  auto const q = scanner.next();
+  auto values = std::vector<std::uint64_t>(4 * q);
+  if (scanner.read(values.data(), values.size()) != values.size())
+    throw std::runtime_error("input: ends early");
+  auto queries = std::vector<Query>(q);
+  for (std::size_t i = 0; i < q; ++i) {
+    auto const* v = &values[4 * i];
+    queries[i] = Query{Location{v[0], v[1]}, Location{v[2], v[3]}};
+  }
+  return queries;
+}
+
+Input read_input(std::string_view text) {
+  auto scanner = Scanner(text);
+  auto input = Input{};
+  input.map = read_map(scanner);
+  input.queries = read_queries(scanner);
+  return input;
+}
+
+void save_map(std::ostream& os, Map const& map) {
+  auto const bounds = weight_bounds(map);
+  if (bounds.max > std::numeric_limits<std::uint16_t>::max())
+    throw std::runtime_error("binary map: weights over 16 bits");
+  auto const width = bounds.max > std::numeric_limits<std::uint8_t>::max() ? 2u : 1u;
+  auto const header = Header{magic, version, width, 0, map.rows, map.cols};
+  os.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+  auto const write = [&](auto narrow) {
+    using W = decltype(narrow);
+    W chunk[4096];
+    for (std::size_t i = 0; i < map.rows * map.cols;) {
+      auto const n = std::min<std::size_t>(std::size(chunk), map.rows * map.cols - i);
+      for (std::size_t k = 0; k < n; ++k)
+        chunk[k] = static_cast<W>(map.nodes[i + k].weight);
+      os.write(reinterpret_cast<char const*>(chunk), static_cast<std::streamsize>(n * sizeof(W)));
+      i += n;
+    }
+  };
+  if (width == 1)
+    write(std::uint8_t{});
+  else
+    write(std::uint16_t{});
+  if (!os)
+    throw std::runtime_error("binary map: write failed");
+}
+
+AnyPackedMap load_map(char const* path) {
+  auto file = std::make_shared<MappedFile>(path);
+  auto header = Header{};
+  if (file->size() < sizeof(header))
+    throw std::runtime_error("binary map: truncated");
+  std::memcpy(&header, file->data(), sizeof(header));
+  if (header.magic != magic || header.version != version)
+    throw std::runtime_error("binary map: not a map of this version");
+  if ((header.width != 1 && header.width != 2)
+      || (header.cols != 0 && header.rows > (file->size() - sizeof(header)) / header.cols)
+      || file->size() != sizeof(header) + header.rows * header.cols * header.width)
+    throw std::runtime_error("binary map: bad shape");
+
+  auto* const weights = file->data() + sizeof(header);
+  if (header.width == 1) {
+    return PackedMap<std::uint8_t>(header.rows, header.cols,
+                                   reinterpret_cast<std::uint8_t*>(weights), std::move(file));
+  }
+  return PackedMap<std::uint16_t>(header.rows, header.cols,
+                                  reinterpret_cast<std::uint16_t*>(weights), std::move(file));
+}
+
+Map unpack(AnyPackedMap const& packed) {
+  return std::visit([](auto const& packed) {
+    auto map = Map(packed.rows, packed.cols);
+    for (std::size_t i = 0; i < packed.size(); ++i)
+      map.nodes[i].weight = packed.weights[i];
+    return map;
+  }, packed);
+}
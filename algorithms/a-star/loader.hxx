@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "astar.hxx"
+#include "batch.hxx"
+
+// Reading main()'s input, and a binary map format, without iostreams.
+
+// The bytes of a file, mapped where the kernel allows it and read into a
+// buffer otherwise (a pipe, a terminal).  Mapped pages are private: writes
+// stay in this process.  Throws std::runtime_error when the file cannot be
+// opened or read.
+class MappedFile {
+public:
+  explicit MappedFile(char const* path);
+  // Reads from fd, which stays open.
+  explicit MappedFile(int fd);
+  static MappedFile standard_input() { return MappedFile(0); }
+
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator = (MappedFile&& other) noexcept;
+  ~MappedFile();
+
+  char* data() noexcept { return data_; }
+  char const* data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+  std::string_view text() const noexcept { return {data_, size_}; }
+
+private:
+  void open(int fd);
+
+  char* data_ = nullptr;
+  std::size_t size_ = 0;
+  bool mapped_ = false;
+  std::vector<char> buffer_;
+};
+
+// The unsigned decimal integers in a text, separated by anything that is
+// not a digit.  read() finds them a block of 32 bytes at a time: one AVX2
+// compare classifies the block, and the numbers are the runs of set bits in
+// its mask.  Values past 64 bits wrap.
+class Scanner {
+public:
+  explicit Scanner(std::string_view text) noexcept:
+    p_{text.data()},
+    end_{text.data() + text.size()}
+  {}
+
+  // Up to n integers into out, fewer only at the end of the text.
+  std::size_t read(std::uint64_t* out, std::size_t n) noexcept;
+
+  // The next integer.  Throws std::runtime_error at the end of the text.
+  std::uint64_t next();
+
+private:
+  std::size_t read_scalar(std::uint64_t* out, std::size_t n) noexcept;
+
+  char const* p_;
+  char const* end_;
+};
+
+// The map of main()'s input (rows, cols, then the weights row by row), the
+// queries (their count, then start and finish of each), or both.  Throw
+// std::runtime_error when the text ends early.
+Map read_map(Scanner& scanner);
+std::vector<Query> read_queries(Scanner& scanner);
+
+struct Input {
+  Map map{0, 0};
+  std::vector<Query> queries;
+};
+
+Input read_input(std::string_view text);
+
+// A map in binary: a 32-byte header ("AMAP", version, bytes per weight,
+// rows, cols) and the weights row by row, 8 or 16 bits each in the host's
+// byte order.  load_map() maps the file and hands the weights out in
+// place, as a PackedMap of the width it was saved with; unpack() widens
+// either to a Map.  save_map() throws std::runtime_error for weights over
+// 16 bits or a failed stream, load_map() for a file that is not a map.
+using AnyPackedMap = std::variant<PackedMap<std::uint8_t>, PackedMap<std::uint16_t>>;
+
+void save_map(std::ostream& os, Map const& map);
+AnyPackedMap load_map(char const* path);
+Map unpack(AnyPackedMap const& map);
@@ -1,71 +1,91 @@
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
 
-#include "astar.hxx"
+#include "batch.hxx"
+#include "hub_labels.hxx"
+#include "loader.hxx"
 
-int main(int, char**) {
-  std::ios::sync_with_stdio(false);
-  std::cin.tie(nullptr);
-  
-  std::size_t rows, cols;
-  std::cin >> rows >> cols;
-
-  auto map = Map(rows, cols);
-  for (std::size_t r = 0; r < map.rows; ++r) {
-    for (std::size_t c = 0; c < map.cols; ++c) {
-      auto& cell = map[r][c];
-      std::cin >> cell.weight;
-      cell.parent = Location{r, c};
+// The labels of map, from path when it holds them, otherwise built and
+// then written there.
+static HubLabels hub_labels(Map const& map, char const* path) {
+  if (path) {
+    if (auto is = std::ifstream(path, std::ios::binary)) {
+      try {
+        auto labels = HubLabels::load(is);
+        if (labels.matches(map))
+          return labels;
+      } catch (std::runtime_error const&) {
+        // Stale or foreign: build them again.
+      }
     }
   }
+  auto labels = HubLabels(map);
+  if (path) {
+    auto os = std::ofstream(path, std::ios::binary);
+    labels.save(os);
+  }
+  return labels;
+}
 
-  std::size_t q;
-  std::cin >> q;
-
-  for (std::size_t i = 0; i < q; ++i) {
-    Location start, finish;
-    std::cin >> start >> finish;
-
-    auto cost = find_paths(map, start, finish);
-    std::cout << cost << '\n';
+// main [--map path] [--save-map path] [--hub-labels [path]]: answers the
+// queries with searches, or with HubLabels, cached in path if given.  The
+// map comes from the binary file given to --map when there is one, and
+// then the input holds only the queries; --save-map writes it there.
+int main(int argc, char** argv) {
+  std::ios::sync_with_stdio(false);
 
-#if 0
-    auto paths = find_paths(map, start, finish);
-    auto cost = paths[finish.row][finish.col].g;
-    std::cout << cost << '\n';
-    continue;
-    
-    std::cout << "Cost from (" << start << ") to (" << finish << ") is: ";
-    if (cost != std::numeric_limits<weight_type>::max())
-      std::cout << cost;
-    else
-      std::cout << "unreachable";
-    std::cout << '\n';
-    std::cout << "Paths:\n";
-    for (std::size_t r = 0; r < map.rows; ++r) {
-      for (std::size_t c = 0; c < map.cols; ++c) {
-        auto const& col = paths[r][c];
-        std::cout << '\t';
-        if (col.g != std::numeric_limits<weight_type>::max())
-          std::cout << col.g;
-        else
-          std::cout << '-';
-      }
-      std::cout << '\n';
+  char const* map_path = nullptr;
+  char const* save_path = nullptr;
+  bool hub = false;
+  char const* labels_path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    auto const arg = std::string_view(argv[i]);
+    if (arg == "--map" && i + 1 < argc) {
+      map_path = argv[++i];
+    } else if (arg == "--save-map" && i + 1 < argc) {
+      save_path = argv[++i];
+    } else if (arg == "--hub-labels") {
+      hub = true;
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        labels_path = argv[++i];
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [--map path] [--save-map path] [--hub-labels [path]] < input\n";
+      return 2;
     }
-    std::cout << "Path: (" << finish << ')';
-    for (Location loc = finish;;) {
-      auto parent = paths[loc.row][loc.col].parent;
-      if (parent == loc) {
-        std::cout << " <- (unreachable)";
-        break;
-      }
-      loc = parent;
-      std::cout << " <- " << '(' << loc << ')';
-      if (loc == start)
-        break;
+  }
+
+  auto input = Input{};
+  try {
+    auto const text = MappedFile::standard_input();
+    auto scanner = Scanner(text.text());
+    input.map = map_path ? unpack(load_map(map_path)) : read_map(scanner);
+    input.queries = read_queries(scanner);
+    if (save_path) {
+      auto os = std::ofstream(save_path, std::ios::binary);
+      save_map(os, input.map);
     }
-    std::cout << '\n';
-    std::cout << '\n';
-#endif
+  } catch (std::runtime_error const& e) {
+    std::cerr << argv[0] << ": " << e.what() << '\n';
+    return 1;
+  }
+  auto const& map = input.map;
+  auto const& queries = input.queries;
+  auto const q = queries.size();
+
+  std::vector<weight_type> costs;
+  if (hub) {
+    auto const labels = hub_labels(map, labels_path);
+    costs.reserve(q);
+    for (auto const& [start, finish] : queries)
+      costs.push_back(labels.distance(start, finish));
+  } else {
+    simd::ThreadPool pool;
+    costs = find_paths(pool, map, queries);
   }
+  for (auto const cost : costs)
+    std::cout << cost << '\n';
 }
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// A monotone radix heap for unsigned integer priorities of any range.
+//
+// Pushes may not go below the last popped priority.  Bucket k > 0 holds the
+// entries whose priority first differs from the last popped one in bit
+// k - 1, and bucket 0 those equal to it; when bucket 0 runs dry, the lowest
+// non-empty bucket is redistributed around its minimum, each entry moving
+// down at least one bucket.  An entry therefore moves at most once per bit,
+// and pushes and pops are O(1) amortised per bit of the priority type.
+//
+// As with BucketQueue, a decrease queues the id again and leaves the old
+// entry for the caller to skip.
+template <typename Priority>
+class RadixHeap {
+  static_assert(std::is_unsigned_v<Priority> && sizeof(Priority) <= 8,
+                "radix heap priorities must be unsigned, up to 64 bits");
+
+public:
+  using id_type = std::uint32_t;
+
+  struct Entry {
+    Priority priority;
+    id_type id;
+  };
+
+  bool empty() const noexcept { return size_ == 0; }
+  std::size_t size() const noexcept { return size_; }
+
+  // Redistributes only here, so that the last popped priority, which
+  // pushes may not go below, is the one the buckets are laid out around.
+  Entry const& top() {
+    if (buckets_[0].empty())
+      refill();
+    return buckets_[0].back();
+  }
+
+  void push_or_decrease(id_type id, Priority priority) {
+    assert(priority >= last_);
+    buckets_[bucket(priority)].push_back({priority, id});
+    ++size_;
+  }
+
+  // Pops the entry top() returned.
+  void pop() noexcept {
+    buckets_[0].pop_back();
+    --size_;
+  }
+
+  void clear() {
+    for (auto& bucket : buckets_)
+      bucket.clear();
+    size_ = 0;
+    last_ = 0;
+  }
+
+private:
+  static constexpr std::size_t bits = sizeof(Priority) * CHAR_BIT;
+
+  std::size_t bucket(Priority priority) const noexcept {
+    auto const diff = priority ^ last_;
+    if (diff == 0)
+      return 0;
+    return static_cast<std::size_t>(
+      64 - __builtin_clzll(static_cast<unsigned long long>(diff)));
+  }
+
+  // Moves the lowest non-empty bucket down around its minimum, which lands
+  // in bucket 0.
+  void refill() {
+    std::size_t k = 1;
+    while (buckets_[k].empty())
+      ++k;
+
+    auto& from = buckets_[k];
+    auto min = from.front().priority;
+    for (auto const& entry : from) {
+      if (entry.priority < min)
+        min = entry.priority;
+    }
+    last_ = min;
+    for (auto const& entry : from)
+      buckets_[bucket(entry.priority)].push_back(entry);
+    from.clear();
+  }
+
+  std::array<std::vector<Entry>, bits + 1> buckets_;
+  std::size_t size_ = 0;
+  Priority last_ = 0;
+};
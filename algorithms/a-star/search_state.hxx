@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "bucket_queue.hxx"
+#include "indexed_heap.hxx"
+#include "radix_heap.hxx"
+
+// The per-query side of find_paths(): what each search writes for the
+// cells it touches, and its open sets, kept apart from the immutable
+// terrain so that one SearchState serves any number of queries, over any
+// map, without reallocating.
+//
+// Every cell carries the generation of the search that last touched it.
+// reset() moves to the next generation, which makes every cell read as
+// unreached again in O(1); a cell's fields are only rewritten when the
+// search first reaches it, so a query costs O(cells it touches).  Closed
+// cells are stamped one past the current generation, and generations step
+// by two.
+//
+// A cell's fields sit together: a relaxation reads the stamp and g and
+// then writes all four, so one line serves it.  Separate stamp, g, parent
+// and slot arrays measured 5-10% slower on 1000x1000 random maps.
+template <typename Cost>
+class SearchState {
+public:
+  using cost_type = Cost;
+  static constexpr cost_type unreached = std::numeric_limits<cost_type>::max();
+
+  // Starts a search over cells 0..size-1.
+  void reset(std::size_t size) {
+    assert(size < not_in_heap);
+    if (cells_.size() < size)
+      cells_.resize(size);
+    if (generation_ >= std::numeric_limits<std::uint32_t>::max() - 2) {
+      for (auto& cell : cells_)
+        cell.stamp = 0;
+      generation_ = 0;
+    }
+    generation_ += 2;
+    heap_.reset(HeapSlots{cells_.data()});
+  }
+
+  cost_type g(std::uint32_t i) const noexcept {
+    return cells_[i].stamp >= generation_ ? cells_[i].g : unreached;
+  }
+  // The cell i was reached from, or i itself for the start.  Only
+  // meaningful for a cell that g() does not report unreached.
+  std::uint32_t parent(std::uint32_t i) const noexcept {
+    return cells_[i].parent;
+  }
+  bool closed(std::uint32_t i) const noexcept {
+    return cells_[i].stamp == generation_ + 1;
+  }
+
+  void close(std::uint32_t i) noexcept { cells_[i].stamp = generation_ + 1; }
+  void reach(std::uint32_t i, cost_type g, std::uint32_t parent) noexcept {
+    auto& cell = cells_[i];
+    if (cell.stamp < generation_) {
+      cell.stamp = generation_;
+      cell.heap_index = not_in_heap;
+    }
+    cell.g = g;
+    cell.parent = parent;
+  }
+  std::uint32_t& heap_index(std::uint32_t i) noexcept { return cells_[i].heap_index; }
+
+  // The open sets, emptied by reset() or here; the heap positions cells
+  // the search has reached.
+  BucketQueue<cost_type>& buckets(std::size_t span) {
+    buckets_.reset(span);
+    return buckets_;
+  }
+  RadixHeap<cost_type>& radix() {
+    radix_.clear();
+    return radix_;
+  }
+  auto& heap() noexcept { return heap_; }
+
+  // The state of the backward half of a bidirectional search, kept here so
+  // that it is reused with this one.
+  SearchState& reverse() {
+    if (!reverse_)
+      reverse_ = std::make_unique<SearchState>();
+    return *reverse_;
+  }
+
+private:
+  struct Cell {
+    std::uint32_t stamp = 0;
+    std::uint32_t parent;
+    std::uint32_t heap_index;
+    cost_type g;
+  };
+
+  struct HeapSlots {
+    Cell* cells;
+    std::uint32_t& operator () (std::uint32_t i) const noexcept {
+      return cells[i].heap_index;
+    }
+  };
+
+  std::vector<Cell> cells_;
+  std::uint32_t generation_ = 0;
+  BucketQueue<cost_type> buckets_{1};
+  RadixHeap<cost_type> radix_;
+  IndexedHeap<cost_type, HeapSlots> heap_{HeapSlots{nullptr}};
+  std::unique_ptr<SearchState> reverse_;
+};
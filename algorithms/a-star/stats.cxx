@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "astar.hxx"
+#include "loader.hxx"
+#include "perf_counters.hxx"
+
+namespace {
+
+// What one query did, and the terrain it crossed.
+struct Record {
+  std::size_t query;
+  Location start;
+  Location finish;
+  double nanoseconds;
+  SearchStats stats;
+  double l1d_misses;
+  double llc_misses;
+  // Manhattan distance between the ends, and the mean weight of the
+  // rectangle they span.
+  std::size_t distance;
+  double box_weight;
+};
+
+// Sums of the weights above and left of each cell, for the mean weight of
+// any rectangle in O(1).
+class WeightSums {
+public:
+  explicit WeightSums(Map const& map):
+    cols_{map.cols + 1},
+    sums_((map.rows + 1) * cols_)
+  {
+    for (std::size_t r = 0; r < map.rows; ++r) {
+      for (std::size_t c = 0; c < map.cols; ++c) {
+        sums_[(r + 1) * cols_ + c + 1] = static_cast<double>(map[r][c].weight)
+          + sums_[r * cols_ + c + 1] + sums_[(r + 1) * cols_ + c] - sums_[r * cols_ + c];
+      }
+    }
+  }
+
+  double mean(Location const& a, Location const& b) const {
+    auto const top = std::min(a.row, b.row), bottom = std::max(a.row, b.row) + 1;
+    auto const left = std::min(a.col, b.col), right = std::max(a.col, b.col) + 1;
+    auto const sum = sums_[bottom * cols_ + right] - sums_[top * cols_ + right]
+      - sums_[bottom * cols_ + left] + sums_[top * cols_ + left];
+    return sum / static_cast<double>((bottom - top) * (right - left));
+  }
+
+private:
+  std::size_t cols_;
+  std::vector<double> sums_;
+};
+
+// The cache miss events of perf::default_events(), where the kernel allows
+// them.
+std::vector<perf::Event> miss_events() {
+  auto events = perf::default_events();
+  events.erase(std::remove_if(events.begin(), events.end(), [](perf::Event const& event) {
+    return std::strcmp(event.name, "l1d_misses") != 0
+      && std::strcmp(event.name, "llc_misses") != 0;
+  }), events.end());
+  return events;
+}
+
+struct Metric {
+  char const* name;
+  std::function<double(Record const&)> value;
+};
+
+double percentile(std::vector<double> const& sorted, double p) {
+  auto const i = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+  return sorted[i];
+}
+
+// Pearson's correlation of x and y over records.
+double correlation(std::vector<Record> const& records, Metric const& x, Metric const& y) {
+  double sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+  for (auto const& record : records) {
+    auto const a = x.value(record), b = y.value(record);
+    sx += a; sy += b; sxx += a * a; syy += b * b; sxy += a * b;
+  }
+  auto const n = static_cast<double>(records.size());
+  auto const d = std::sqrt((n * sxx - sx * sx) * (n * syy - sy * sy));
+  return d > 0 ? (n * sxy - sx * sy) / d : 0;
+}
+
+}  // namespace
+
+// stats [astar|bidirectional|jump-point] [slowest]: answers the queries of
+// main()'s input one at a time and reports how the searches went.  Each
+// metric is summarised over the batch, then correlated with the latency,
+// and the slowest queries are listed with everything recorded for them.
+int main(int argc, char** argv) {
+  auto algorithm = Algorithm::AStar;
+  if (argc > 1) {
+    auto const name = std::string_view(argv[1]);
+    if (name == "bidirectional")
+      algorithm = Algorithm::Bidirectional;
+    else if (name == "jump-point")
+      algorithm = Algorithm::JumpPoint;
+    else if (name != "astar") {
+      std::cerr << "usage: " << argv[0]
+                << " [astar|bidirectional|jump-point] [slowest] < input\n";
+      return 2;
+    }
+  }
+  std::size_t const slowest = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10;
+
+  auto input = Input{};
+  try {
+    input = read_input(MappedFile::standard_input().text());
+  } catch (std::runtime_error const& e) {
+    std::cerr << argv[0] << ": " << e.what() << '\n';
+    return 1;
+  }
+  auto const& map = input.map;
+  auto const& queries = input.queries;
+  auto const q = queries.size();
+  auto const rows = map.rows, cols = map.cols;
+
+  auto const sums = WeightSums(map);
+  auto counters = perf::Counters(miss_events());
+  auto const bounds = weight_bounds(map);
+  auto search = SearchState<weight_type>();
+  auto records = std::vector<Record>();
+  records.reserve(q);
+  for (std::size_t i = 0; i < q; ++i) {
+    auto const& [start, finish] = queries[i];
+    auto record = Record{i, start, finish, 0, {}, 0, 0, mdist(start, finish),
+                         sums.mean(start, finish)};
+    counters.start();
+    auto const begin = std::chrono::steady_clock::now();
+    auto cost = find_paths(map, bounds, search, start, finish, record.stats,
+                           OpenSet::Auto, algorithm);
+    auto const end = std::chrono::steady_clock::now();
+    counters.stop();
+    static_cast<void>(cost);
+    record.nanoseconds = std::chrono::duration<double, std::nano>(end - begin).count();
+    for (auto const& [name, count] : counters.read())
+      (std::strcmp(name, "l1d_misses") == 0 ? record.l1d_misses : record.llc_misses) = count;
+    records.push_back(record);
+  }
+  if (records.empty())
+    return 0;
+
+  auto metrics = std::vector<Metric>{
+    {"latency_ns", [](Record const& r) { return r.nanoseconds; }},
+    {"expansions", [](Record const& r) { return double(r.stats.expansions); }},
+    {"reopenings", [](Record const& r) { return double(r.stats.reopenings); }},
+    {"stale_pops", [](Record const& r) { return double(r.stats.stale_pops); }},
+    {"heap_ops", [](Record const& r) { return double(r.stats.pushes + r.stats.pops); }},
+    {"max_open", [](Record const& r) { return double(r.stats.max_open); }},
+    {"heuristics", [](Record const& r) { return double(r.stats.heuristic_evaluations); }},
+    {"distance", [](Record const& r) { return double(r.distance); }},
+    {"box_weight", [](Record const& r) { return r.box_weight; }},
+  };
+  if (counters.available()) {
+    metrics.push_back({"l1d_misses", [](Record const& r) { return r.l1d_misses; }});
+    metrics.push_back({"llc_misses", [](Record const& r) { return r.llc_misses; }});
+  }
+
+  auto& os = std::cout;
+  os << std::fixed << std::setprecision(1);
+  os << records.size() << " queries over " << rows << 'x' << cols << "\n\n";
+  os << std::left << std::setw(12) << "metric" << std::right;
+  for (auto const* column : {"mean", "p50", "p90", "p99", "max", "r(latency)"})
+    os << std::setw(12) << column;
+  os << '\n';
+  for (auto const& metric : metrics) {
+    auto values = std::vector<double>();
+    for (auto const& record : records)
+      values.push_back(metric.value(record));
+    std::sort(values.begin(), values.end());
+    double sum = 0;
+    for (auto value : values)
+      sum += value;
+    os << std::left << std::setw(12) << metric.name << std::right
+       << std::setw(12) << sum / static_cast<double>(values.size())
+       << std::setw(12) << percentile(values, 0.5)
+       << std::setw(12) << percentile(values, 0.9)
+       << std::setw(12) << percentile(values, 0.99)
+       << std::setw(12) << values.back()
+       << std::setw(12) << std::setprecision(3) << correlation(records, metric, metrics[0])
+       << std::setprecision(1) << '\n';
+  }
+
+  auto const n = std::min(slowest, records.size());
+  std::partial_sort(records.begin(), records.begin() + n, records.end(),
+                    [](Record const& lhs, Record const& rhs) {
+                      return lhs.nanoseconds > rhs.nanoseconds;
+                    });
+  os << "\nslowest " << n << ":\n";
+  os << std::left << std::setw(8) << "query" << std::setw(14) << "start"
+     << std::setw(14) << "finish" << std::right;
+  for (std::size_t m = 0; m < metrics.size(); ++m)
+    os << std::setw(12) << metrics[m].name;
+  os << '\n';
+  for (std::size_t i = 0; i < n; ++i) {
+    auto const& record = records[i];
+    auto const at = [](Location const& loc) {
+      return std::to_string(loc.row) + ',' + std::to_string(loc.col);
+    };
+    os << std::left << std::setw(8) << record.query << std::setw(14) << at(record.start)
+       << std::setw(14) << at(record.finish) << std::right;
+    for (auto const& metric : metrics)
+      os << std::setw(12) << metric.value(record);
+    os << '\n';
+  }
+}
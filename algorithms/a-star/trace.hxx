@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+// Tracing policies for find_paths().  A search calls its policy as it
+// goes: expand() when it closes a state, stale() when it pops an entry a
+// decrease left behind, relax() when it lowers the cost of a state (again
+// if the state had a cost already), push() and pop() on its open set, and
+// heuristic() for every heuristic it evaluates.  Ids are cell numbers,
+// row * cols + col, or cell * 4 + direction for Algorithm::JumpPoint.
+//
+// The calls are inline and NoTrace's are empty, so a search instantiated
+// with it compiles to the same code as one without any.
+
+// Records nothing.
+struct NoTrace {
+  void expand(std::uint32_t, std::uint64_t) noexcept {}
+  void stale(std::uint32_t) noexcept {}
+  void relax(std::uint32_t, std::uint32_t, std::uint64_t, bool) noexcept {}
+  void push(std::size_t) noexcept {}
+  void pop() noexcept {}
+  void heuristic() noexcept {}
+};
+
+// Counts what the searches it is passed to do, summed over them.
+struct SearchStats {
+  // States closed.
+  std::size_t expansions = 0;
+  // Entries popped for states already closed.
+  std::size_t stale_pops = 0;
+  // Costs lowered, and of those, costs lowered again: a decrease-key in
+  // the heap, a second entry in the other open sets.
+  std::size_t relaxations = 0;
+  std::size_t reopenings = 0;
+  // Open set operations, and the most entries it held at once.
+  std::size_t pushes = 0;
+  std::size_t pops = 0;
+  std::size_t max_open = 0;
+  std::size_t heuristic_evaluations = 0;
+
+  void expand(std::uint32_t, std::uint64_t) noexcept { ++expansions; }
+  void stale(std::uint32_t) noexcept { ++stale_pops; }
+  void relax(std::uint32_t, std::uint32_t, std::uint64_t, bool again) noexcept {
+    ++relaxations;
+    reopenings += again;
+  }
+  void push(std::size_t open) noexcept {
+    ++pushes;
+    max_open = std::max(max_open, open);
+  }
+  void pop() noexcept { ++pops; }
+  void heuristic() noexcept { ++heuristic_evaluations; }
+
+  SearchStats& operator += (SearchStats const& other) noexcept {
+    expansions += other.expansions;
+    stale_pops += other.stale_pops;
+    relaxations += other.relaxations;
+    reopenings += other.reopenings;
+    pushes += other.pushes;
+    pops += other.pops;
+    max_open = std::max(max_open, other.max_open);
+    heuristic_evaluations += other.heuristic_evaluations;
+    return *this;
+  }
+};
+
+// Keeps the last capacity() events in a ring buffer, for searches that may
+// run on any number of threads at once.  A writer claims the next slot with
+// one fetch_add and never waits; each slot is stamped with the number of
+// the event written last, so that events() can drop one overwritten while
+// it was written.  Read the trace once the searches writing it are done.
+class EventTrace {
+public:
+  enum class Kind : std::uint8_t { expand, stale, relax };
+
+  struct Event {
+    Kind kind;
+    std::uint32_t id;
+    // The state id was reached from (relax), or id itself.
+    std::uint32_t parent;
+    std::uint64_t cost;
+  };
+
+  // Room for capacity events, rounded up to a power of two.
+  explicit EventTrace(std::size_t capacity = std::size_t{1} << 20):
+    capacity_{round_up(capacity)},
+    slots_{std::make_unique<Slot[]>(capacity_)}
+  {}
+
+  void expand(std::uint32_t id, std::uint64_t g) noexcept {
+    record(Kind::expand, id, id, g);
+  }
+  void stale(std::uint32_t id) noexcept {
+    record(Kind::stale, id, id, 0);
+  }
+  void relax(std::uint32_t id, std::uint32_t parent, std::uint64_t cost, bool) noexcept {
+    record(Kind::relax, id, parent, cost);
+  }
+  void push(std::size_t) noexcept {}
+  void pop() noexcept {}
+  void heuristic() noexcept {}
+
+  std::size_t capacity() const noexcept { return capacity_; }
+  // Events recorded since construction or clear(), kept or not.
+  std::uint64_t recorded() const noexcept {
+    return next_.load(std::memory_order_acquire);
+  }
+
+  // The events kept, oldest first.
+  std::vector<Event> events() const {
+    auto const last = recorded();
+    auto const first = last > capacity_ ? last - capacity_ : 0;
+    auto events = std::vector<Event>();
+    events.reserve(last - first);
+    for (auto n = first; n < last; ++n) {
+      auto const& slot = slots_[n & (capacity_ - 1)];
+      if (slot.sequence.load(std::memory_order_acquire) != n + 1)
+        continue;
+      events.push_back({
+        slot.kind.load(std::memory_order_relaxed),
+        slot.id.load(std::memory_order_relaxed),
+        slot.parent.load(std::memory_order_relaxed),
+        slot.cost.load(std::memory_order_relaxed),
+      });
+    }
+    return events;
+  }
+
+  // One line per event kept: its kind, id, parent and cost.
+  void dump(std::ostream& os) const {
+    static constexpr char const* names[] = {"expand", "stale", "relax"};
+    for (auto const& event : events()) {
+      os << names[static_cast<int>(event.kind)] << ' ' << event.id << ' '
+         << event.parent << ' ' << event.cost << '\n';
+    }
+  }
+
+  void clear() noexcept {
+    for (std::size_t i = 0; i < capacity_; ++i)
+      slots_[i].sequence.store(0, std::memory_order_relaxed);
+    next_.store(0, std::memory_order_release);
+  }
+
+private:
+  // Relaxed atomics store like plain fields on the targets we build for.
+  struct Slot {
+    std::atomic<std::uint64_t> sequence{0};
+    std::atomic<std::uint64_t> cost;
+    std::atomic<std::uint32_t> id;
+    std::atomic<std::uint32_t> parent;
+    std::atomic<Kind> kind;
+  };
+
+  static std::size_t round_up(std::size_t n) noexcept {
+    std::size_t capacity = 1;
+    while (capacity < n)
+      capacity *= 2;
+    return capacity;
+  }
+
+  void record(Kind kind, std::uint32_t id, std::uint32_t parent,
+              std::uint64_t cost) noexcept {
+    auto const n = next_.fetch_add(1, std::memory_order_relaxed);
+    auto& slot = slots_[n & (capacity_ - 1)];
+    slot.kind.store(kind, std::memory_order_relaxed);
+    slot.id.store(id, std::memory_order_relaxed);
+    slot.parent.store(parent, std::memory_order_relaxed);
+    slot.cost.store(cost, std::memory_order_relaxed);
+    slot.sequence.store(n + 1, std::memory_order_release);
+  }
+
+  std::size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<std::uint64_t> next_{0};
+};
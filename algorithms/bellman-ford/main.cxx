@@ -3,76 +3,77 @@
 #include <algorithm>
 #include <numeric>
 #include <iomanip>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
 
-struct BoundEdge {
-  BoundEdge(int v_, int l_)
-  : v(v_), l(l_) {}
+#include "../graph/bellman_ford.hxx"
+#include "../graph/csr.hxx"
 
-  int v, l;
-};
+typedef graph::Csr<int> Graph;
 
-typedef std::vector<std::vector<BoundEdge>> Graph;
-
-int bellman_ford(Graph const &graph, int s) {
-  auto const n = graph.size();
-  std::vector<int> memo(n, std::numeric_limits<int>::max());
-
-  memo[s] = 0;
-
-  for (int i = 1; i < graph.size(); ++i) {
-    auto alt = std::numeric_limits<int>::max();
-    for (int j = 0; j < graph.size(); ++j) {
-      if (memo[j] == std::numeric_limits<int>::max())
-        continue;
-
-      for (auto const &edge : graph[j]) {
-        if (memo[j] + edge.l < memo[edge.v]) {
-          memo[edge.v] = memo[j] + edge.l;
-        }
-      }
-    }
-  }
-
-  for (int i = 0; i < graph.size(); ++i) {
-    for (auto const &edge : graph[i]) {
-      if (memo[i] + edge.l < memo[edge.v]) {
-        std::cout << "Negative cycle detected\n";
-        return -1;
-      }
-    }
+int bellman_ford(Graph const &graph, int s, graph::BellmanFord mode,
+                 simd::ThreadPool *pool) {
+  auto const n = graph.vertices();
+  auto const paths = graph::bellman_ford(graph, graph::vertex_type(s), mode, pool);
+  if (paths.negative_cycle) {
+    std::cout << "Negative cycle detected\n";
+    return -1;
   }
 
   auto mn = std::numeric_limits<int>::max();
   for (int i = 0; i < n; ++i) {
     if (i == s)
       continue;
-    mn = std::min(mn, memo[i]);
+    mn = std::min(mn, paths.dist[i]);
   }
   return mn;
 }
 
+// main [rounds|queue|frontier] [threads]: queue by default, and frontier
+// over all of the machine's CPUs.
 int main(int argc, char *argv[]) {
   std::ios::sync_with_stdio(false);
   std::cin.tie(nullptr);
 
+  auto mode = graph::BellmanFord::Queue;
+  if (argc > 1) {
+    std::string const name = argv[1];
+    if (name == "rounds")
+      mode = graph::BellmanFord::Rounds;
+    else if (name == "frontier")
+      mode = graph::BellmanFord::Frontier;
+    else if (name != "queue") {
+      std::cerr << "usage: " << argv[0] << " [rounds|queue|frontier] [threads] < input\n";
+      return 2;
+    }
+  }
+  // Only frontier runs on a pool.
+  std::unique_ptr<simd::ThreadPool> pool;
+  if (mode == graph::BellmanFord::Frontier)
+    pool = std::make_unique<simd::ThreadPool>(
+      argc > 2 ? unsigned(std::stoul(argv[2])) : std::thread::hardware_concurrency());
+
   int n, m;
   std::cin >> n >> m;
 
-  Graph graph(n);
+  std::vector<graph::Edge<int>> edges;
+  edges.reserve(m);
   for (int i = 0; i < m; ++i) {
     int v, w, l;
     std::cin >> v >> w >> l;
     --v;
     --w;
 
-    auto &edges = graph[v];
-    edges.emplace_back(w, l);
+    edges.push_back({graph::vertex_type(v), graph::vertex_type(w), l});
   }
+  Graph graph(n, edges);
 
   int min = std::numeric_limits<int>::max();
-  for (int i = 0; i < graph.size(); i+=2) {
+  for (int i = 0; i < n; i+=2) {
     std::cout << "source=" << i << '\n';
-    min = std::min(min, bellman_ford(graph, i));
+    min = std::min(min, bellman_ford(graph, i, mode, pool.get()));
   }
 
   std::cout << "min=" << min << '\n';
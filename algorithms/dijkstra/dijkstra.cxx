@@ -7,15 +7,9 @@
 #include <map>
 #include <set>
 
-struct BoundEdge {
-  BoundEdge(int v_, int r_)
-  : v(v_)
-  , r(r_)
-  {}
-  int v, r;
-};
+#include "../graph/csr.hxx"
 
-typedef std::vector<std::vector<BoundEdge>> Graph;
+typedef graph::Csr<int> Graph;
 
 struct Dist {
   Dist(int v_, int d_)
@@ -30,7 +24,7 @@ bool operator > (Dist const &l, Dist const &r) {
 }
 
 auto dijkstra(Graph const &graph, int s) -> void {
-  auto const n = graph.size();
+  auto const n = graph.vertices();
   std::vector<long long int> dists(n, -1);
   dists[s] = 0;
 
@@ -46,10 +40,8 @@ auto dijkstra(Graph const &graph, int s) -> void {
       continue;
     }
 
-    auto const &neighbours = graph[u];
-    for (auto iter = neighbours.cbegin(); iter != neighbours.cend(); ++iter) {
-      int v = iter->v;
-      int alt = dists[u] + iter->r;
+    for (auto const [v, r] : graph.out(u)) {
+      int alt = dists[u] + r;
       if (alt < dists[v] || dists[v] < 0) {
         dists[v] = alt;
         queue.emplace(v, dists[v]);
@@ -74,16 +66,18 @@ int main() {
     int n, m;
     scanf("%d %d", &n, &m);
     
-    // Read edges.
-    Graph graph(n);
+    // Read edges, both ways.
+    std::vector<graph::Edge<int>> edges;
+    edges.reserve(2 * m);
     for (int i = 0; i < m; i++) {
       int u, v, r;
       scanf("%d %d %d", &u, &v, &r);
       u--;
       v--;
-      graph[u].push_back(BoundEdge(v, r));
-      graph[v].push_back(BoundEdge(u, r));
+      edges.push_back({graph::vertex_type(u), graph::vertex_type(v), r});
+      edges.push_back({graph::vertex_type(v), graph::vertex_type(u), r});
     }
+    Graph graph(n, edges);
 
     // Read the source vertex.
     int s;
@@ -1,67 +1,67 @@
 #include <iostream>
-#include <vector>
 #include <algorithm>
-#include <numeric>
-#include <iomanip>
-
-struct BoundEdge {
-  BoundEdge(int v_, int l_)
-  : v(v_), l(l_) {}
-
-  int v, l;
-};
-
-typedef std::vector<std::vector<BoundEdge>> Graph;
-
-int ffloyd_warshall(Graph const &graph) {
-  auto const n = graph.size();
-  auto const zero = std::numeric_limits<int>::max();
-  std::vector<std::vector<int>> const memo_zero(n, std::vector<int>(n, zero));
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+
+#include "../../vectorization/min_plus.hxx"
+#include "../../vectorization/thread_pool.hxx"
+
+namespace {
+
+constexpr std::int32_t inf = simd::min_plus_inf;
+constexpr std::size_t block = simd::min_plus_tile;
+
+// A square matrix of distances, on 64-byte lines, its rows padded to a
+// whole number of tiles.  The padding vertices have no edges.
+class Matrix {
+public:
+  explicit Matrix(std::size_t n):
+    n_{n},
+    stride_{(n + block - 1) / block * block},
+    data_{new (std::align_val_t{64}) std::int32_t[stride_ * stride_]}
+  {
+    std::fill(data_.get(), data_.get() + stride_ * stride_, inf);
+    for (std::size_t i = 0; i < stride_; ++i)
+      (*this)(i, i) = 0;
+  }
 
-  std::vector<std::vector<int>> memo(n);
-  std::vector<std::vector<int>> memo_prev(memo_zero);
+  std::size_t size() const noexcept { return n_; }
+  std::size_t stride() const noexcept { return stride_; }
+  std::int32_t* data() noexcept { return data_.get(); }
 
-  for (int i = 0; i < n; ++i) {
-    memo_prev[i][i] = 0;
-    auto const &edges = graph[i];
-    for (auto const &edge : edges) {
-      memo_prev[i][edge.v] = edge.l;
-    }
+  std::int32_t& operator () (std::size_t i, std::size_t j) noexcept {
+    return data_[i * stride_ + j];
+  }
+  std::int32_t operator () (std::size_t i, std::size_t j) const noexcept {
+    return data_[i * stride_ + j];
   }
 
-  for (int k = 0; k < n; ++k) {
-    memo = memo_zero;
-    for (int i = 0; i < n; ++i) {
-      for (int j = 0; j < n; ++j) {
-        auto const l_ik = memo_prev[i][k];
-        auto const l_kj = memo_prev[k][j];
-
-        auto alt = memo_prev[i][j];
-        if (l_ik != zero && l_kj != zero) {
-          alt = std::min(alt, l_ik + l_kj);
-        }
-        
-        memo[i][j] = alt;
-      }
+private:
+  struct Free {
+    void operator () (std::int32_t* p) const noexcept {
+      operator delete[](p, std::align_val_t{64});
     }
-    memo.swap(memo_prev);
-  }
+  };
 
-  for (int i = 0; i < n; ++i) {
-    assert(memo_prev[i][i] == 0 && "Negative cycle detected");
-  }
+  std::size_t n_;
+  std::size_t stride_;
+  std::unique_ptr<std::int32_t[], Free> data_;
+};
 
-  auto mn = std::numeric_limits<int>::max();
-  for (int i = 0; i < n; ++i) {
-    for (int j = 0; j < n; ++j) {
-      if (i == j)
-        continue;
-      mn = std::min(mn, memo[i][j]);
-    }
-  }
-  return mn;
+}  // namespace
+
+// Floyd-Warshall in place, a tile of k at a time (see
+// simd::min_plus_closure()).
+void ffloyd_warshall(Matrix &dist, simd::ThreadPool &pool) {
+  simd::min_plus_closure(pool, dist.data(), dist.stride(), dist.stride());
 }
 
+// main [threads]: all of the machine's CPUs by default.
 int main(int argc, char *argv[]) {
   std::ios::sync_with_stdio(false);
   std::cin.tie(nullptr);
@@ -69,20 +69,40 @@ int main(int argc, char *argv[]) {
   int n, m;
   std::cin >> n >> m;
 
-  Graph graph(n);
+  Matrix dist(n);
   for (int i = 0; i < m; ++i) {
     int v, w, l;
     std::cin >> v >> w >> l;
     --v;
     --w;
 
-    auto &edges = graph[v];
-    edges.emplace_back(w, l);
+    dist(v, w) = std::min(dist(v, w), l);
+  }
+
+  simd::ThreadPool pool(argc > 1 ? unsigned(std::stoul(argv[1]))
+                                 : std::thread::hardware_concurrency());
+  ffloyd_warshall(dist, pool);
+
+  for (int i = 0; i < n; ++i) {
+    if (dist(i, i) < 0) {
+      std::cout << "Negative cycle detected\n";
+      return 1;
+    }
   }
 
-  auto const min = ffloyd_warshall(graph);
+  auto min = std::numeric_limits<int>::max();
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      if (i == j)
+        continue;
+      min = std::min(min, dist(i, j));
+    }
+  }
 
   std::cout << "min=" << min << '\n';
-  
+
   return 0;
 }
+
+// % V=../../vectorization
+// % g++ -std=c++2a -O2 -march=native -pthread main.cxx $V/min_plus.cxx $V/simd*.cxx $V/frame.cxx $V/thread_pool.cxx -o main
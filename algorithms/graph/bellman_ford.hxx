@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "csr.hxx"
+#include "../../vectorization/thread_pool.hxx"
+#include "../../vectorization/work_stealing.hxx"
+
+namespace graph {
+
+// How bellman_ford() looks for edges to relax.  All of them stop as soon
+// as nothing is left to relax, and report a negative cycle reachable from
+// the source instead of looping on it.
+enum class BellmanFord {
+  // Rounds over every edge, until a round lowers nothing.  A round that
+  // still lowers a distance after n of them found a cycle.
+  Rounds,
+  // SPFA: a FIFO queue of the vertices whose distance was lowered since
+  // they were last scanned.  Each relaxation counts the edges on the path
+  // it found, and a path of n edges has gone round a cycle.
+  Queue,
+  // Rounds over the out-edges of the vertices the previous round lowered
+  // only, split over a pool's workers, which lower distances with atomic
+  // compare-and-swap.  Cycles are found as in Rounds.
+  Frontier,
+};
+
+template <typename Weight>
+struct ShortestPaths {
+  static constexpr Weight unreachable = std::numeric_limits<Weight>::max();
+
+  // The distance of each vertex from the source, or unreachable.  Partial
+  // when negative_cycle is set.
+  std::vector<Weight> dist;
+  bool negative_cycle = false;
+};
+
+namespace detail {
+
+template <typename Weight>
+void relax_rounds(Csr<Weight> const& graph, ShortestPaths<Weight>& paths) {
+  auto const n = graph.vertices();
+  auto& dist = paths.dist;
+  for (std::size_t round = 1;; ++round) {
+    bool lowered = false;
+    for (vertex_type u = 0; u < n; ++u) {
+      if (dist[u] == paths.unreachable)
+        continue;
+      for (auto const [v, weight] : graph.out(u)) {
+        if (dist[u] + weight < dist[v]) {
+          dist[v] = dist[u] + weight;
+          lowered = true;
+        }
+      }
+    }
+    if (!lowered)
+      return;
+    if (round == n) {
+      paths.negative_cycle = true;
+      return;
+    }
+  }
+}
+
+template <typename Weight>
+void relax_queue(Csr<Weight> const& graph, vertex_type s,
+                 ShortestPaths<Weight>& paths) {
+  auto const n = graph.vertices();
+  auto& dist = paths.dist;
+  // A vertex is queued at most once at a time, so a ring of n holds them.
+  auto queue = std::vector<vertex_type>(n);
+  auto queued = std::vector<char>(n, 0);
+  auto edges = std::vector<std::uint32_t>(n, 0);
+  std::size_t head = 0, size = 1;
+  queue[0] = s;
+  queued[s] = 1;
+  while (size != 0) {
+    auto const u = queue[head];
+    head = head + 1 == n ? 0 : head + 1;
+    --size;
+    queued[u] = 0;
+    for (auto const [v, weight] : graph.out(u)) {
+      if (dist[u] + weight >= dist[v])
+        continue;
+      dist[v] = dist[u] + weight;
+      edges[v] = edges[u] + 1;
+      if (edges[v] >= n) {
+        paths.negative_cycle = true;
+        return;
+      }
+      if (!queued[v]) {
+        queue[(head + size) % n] = v;
+        queued[v] = 1;
+        ++size;
+      }
+    }
+  }
+}
+
+template <typename Weight>
+void relax_frontier(Csr<Weight> const& graph, vertex_type s,
+                    ShortestPaths<Weight>& paths, simd::ThreadPool* pool) {
+  auto const n = graph.vertices();
+  auto const dist = std::make_unique<std::atomic<Weight>[]>(n);
+  // The last round that put each vertex in the next frontier.
+  auto const round_of = std::make_unique<std::atomic<std::uint32_t>[]>(n);
+  for (std::size_t v = 0; v < n; ++v) {
+    dist[v].store(paths.dist[v], std::memory_order_relaxed);
+    round_of[v].store(0, std::memory_order_relaxed);
+  }
+
+  // Each worker collects the next frontier in a list of its own.
+  struct alignas(64) Next {
+    std::vector<vertex_type> vertices;
+  };
+  auto next = std::vector<Next>(pool ? pool->size() : 1);
+  auto frontier = std::vector<vertex_type>{s};
+  // Enough vertices per task that a steal is worth its CAS.
+  constexpr std::size_t grain = 64;
+
+  for (std::uint32_t round = 1; !frontier.empty(); ++round) {
+    if (round > n) {
+      paths.negative_cycle = true;
+      break;
+    }
+    auto const relax = [&](unsigned worker, std::size_t task) {
+      auto const first = task * grain;
+      auto const last = std::min(first + grain, frontier.size());
+      for (auto i = first; i < last; ++i) {
+        auto const u = frontier[i];
+        auto const du = dist[u].load(std::memory_order_relaxed);
+        for (auto const [v, weight] : graph.out(u)) {
+          auto const alt = du + weight;
+          auto current = dist[v].load(std::memory_order_relaxed);
+          while (alt < current) {
+            if (dist[v].compare_exchange_weak(current, alt, std::memory_order_relaxed)) {
+              if (round_of[v].exchange(round, std::memory_order_relaxed) != round)
+                next[worker].vertices.push_back(v);
+              break;
+            }
+          }
+        }
+      }
+    };
+    auto const tasks = (frontier.size() + grain - 1) / grain;
+    if (pool) {
+      simd::for_each_stealing(*pool, tasks, relax);
+    } else {
+      for (std::size_t task = 0; task < tasks; ++task)
+        relax(0, task);
+    }
+
+    frontier.clear();
+    for (auto& list : next) {
+      frontier.insert(frontier.end(), list.vertices.begin(), list.vertices.end());
+      list.vertices.clear();
+    }
+  }
+
+  for (std::size_t v = 0; v < n; ++v)
+    paths.dist[v] = dist[v].load(std::memory_order_relaxed);
+}
+
+}  // namespace detail
+
+// Distances from s over graph, whose weights may be negative.  pool is
+// only used by BellmanFord::Frontier, which runs on the calling thread
+// without one.
+template <typename Weight>
+ShortestPaths<Weight> bellman_ford(Csr<Weight> const& graph, vertex_type s,
+                                   BellmanFord mode = BellmanFord::Queue,
+                                   simd::ThreadPool* pool = nullptr) {
+  auto paths = ShortestPaths<Weight>();
+  paths.dist.assign(graph.vertices(), paths.unreachable);
+  paths.dist[s] = 0;
+  switch (mode) {
+  case BellmanFord::Rounds:
+    detail::relax_rounds(graph, paths);
+    break;
+  case BellmanFord::Queue:
+    detail::relax_queue(graph, s, paths);
+    break;
+  case BellmanFord::Frontier:
+    detail::relax_frontier(graph, s, paths, pool);
+    break;
+  }
+  return paths;
+}
+
+}  // namespace graph
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace graph {
+
+using vertex_type = std::uint32_t;
+
+// An edge of an edge list, as the solvers read them.
+template <typename Weight>
+struct Edge {
+  vertex_type from;
+  vertex_type to;
+  Weight weight;
+};
+
+// A directed graph in compressed sparse row form: the out-edges of u are
+// numbered offsets()[u] .. offsets()[u + 1], and their targets and weights
+// lie in two packed arrays.  A scan of u's edges streams both arrays, and
+// the whole graph is three allocations however many vertices it has.
+template <typename Weight>
+class Csr {
+public:
+  using weight_type = Weight;
+
+  struct Arc {
+    vertex_type to;
+    Weight weight;
+  };
+
+  // The out-edges of one vertex, iterated as Arcs.
+  class Arcs {
+  public:
+    class iterator {
+    public:
+      iterator(vertex_type const* to, Weight const* weight) noexcept:
+        to_{to},
+        weight_{weight}
+      {}
+
+      Arc operator * () const noexcept { return {*to_, *weight_}; }
+      iterator& operator ++ () noexcept {
+        ++to_;
+        ++weight_;
+        return *this;
+      }
+      friend bool operator != (iterator const& lhs, iterator const& rhs) noexcept {
+        return lhs.to_ != rhs.to_;
+      }
+
+    private:
+      vertex_type const* to_;
+      Weight const* weight_;
+    };
+
+    Arcs(vertex_type const* to, Weight const* weight, std::size_t n) noexcept:
+      to_{to},
+      weight_{weight},
+      n_{n}
+    {}
+
+    iterator begin() const noexcept { return {to_, weight_}; }
+    iterator end() const noexcept { return {to_ + n_, weight_ + n_}; }
+    std::size_t size() const noexcept { return n_; }
+
+  private:
+    vertex_type const* to_;
+    Weight const* weight_;
+    std::size_t n_;
+  };
+
+  Csr() = default;
+
+  // The graph of n vertices and edges[0..m), in two passes over the list:
+  // one counts the out-degrees, the other places each edge.  Edges of one
+  // vertex keep their order in the list.
+  Csr(std::size_t n, Edge<Weight> const* edges, std::size_t m) {
+    build(n, m, [edges, m](auto&& visit) {
+      for (std::size_t i = 0; i < m; ++i)
+        visit(edges[i].from, edges[i].to, edges[i].weight);
+    });
+  }
+
+  Csr(std::size_t n, std::vector<Edge<Weight>> const& edges):
+    Csr(n, edges.data(), edges.size())
+  {}
+
+  std::size_t vertices() const noexcept { return offsets_.size() - 1; }
+  std::size_t edges() const noexcept { return targets_.size(); }
+
+  Arcs out(vertex_type u) const noexcept {
+    auto const first = offsets_[u];
+    return {targets_.data() + first, weights_.data() + first, offsets_[u + 1] - first};
+  }
+
+  // The packed arrays.  weights() may be rewritten in place, as Johnson's
+  // reweighting does.
+  std::size_t const* offsets() const noexcept { return offsets_.data(); }
+  vertex_type const* targets() const noexcept { return targets_.data(); }
+  Weight const* weights() const noexcept { return weights_.data(); }
+  Weight* weights() noexcept { return weights_.data(); }
+
+private:
+  // each(visit) calls visit(from, to, weight) for each of the m edges, the
+  // same ones in the same order every time.  Degrees of u are counted in
+  // offsets_[u + 2], so that after the prefix sum offsets_[u + 1] is where
+  // u's edges start, and placing them moves it on to where they end.
+  template <typename Each>
+  void build(std::size_t n, std::size_t m, Each&& each) {
+    offsets_.assign(n + 2, 0);
+    targets_.resize(m);
+    weights_.resize(m);
+    each([this](vertex_type from, vertex_type, Weight) { ++offsets_[from + 2]; });
+    for (std::size_t u = 2; u < n + 2; ++u)
+      offsets_[u] += offsets_[u - 1];
+    each([this](vertex_type from, vertex_type to, Weight weight) {
+      auto const e = offsets_[from + 1]++;
+      targets_[e] = to;
+      weights_[e] = weight;
+    });
+    offsets_.pop_back();
+  }
+
+  std::vector<std::size_t> offsets_ = {0};
+  std::vector<vertex_type> targets_;
+  std::vector<Weight> weights_;
+};
+
+}  // namespace graph
@@ -1,11 +1,18 @@
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <climits>
 #include <cstdio>
-#include <deque>
-#include <queue>
+#include <cstdlib>
+#include <functional>
+#include <thread>
 #include <vector>
 
+#include "../graph/bellman_ford.hxx"
+#include "../graph/csr.hxx"
+#include "../../vectorization/thread_pool.hxx"
+#include "../../vectorization/work_stealing.hxx"
+
 /*
 
 In this assignment you will implement one or more algorithms for the all-pairs shortest-path problem. Here are data files describing three graphs:
@@ -34,13 +41,7 @@ For fun, try computing the shortest shortest path of the graph in the file above
 // shortest=-19
 // go run g.go  1548.46s user 10.51s system 96% cpu 26:47.92 total
 
-struct Edge {
-  Edge(int v_, int r_)
-    : v(v_)
-    , r(r_)
-  {}
-  int v, r;
-};
+typedef graph::Csr<int> Graph;
 
 struct Dist {
   Dist(int v_, int d_)
@@ -54,152 +55,135 @@ bool operator > (Dist const &l, Dist const &r) {
   return l.d > r.d;
 }
 
-typedef std::pair<std::vector<int>, bool> bellman_ford_result_type;
-
-auto bellman_ford(int n, int m, std::deque<std::vector<Edge>> const &graph, int s)
-  -> bellman_ford_result_type {
-  std::deque<std::vector<Edge>> graph_rev(graph.size());
-  for (int v = 0; v < graph.size(); ++v) {
-    auto const &edges = graph[v];
-    for (auto it = edges.cbegin(); it != edges.cend(); ++it) {
-      graph_rev[it->v].push_back(Edge(v, it->r));
-    }
-  }
-
-  std::vector<int> memo(n+1);
-  std::vector<int> prev_memo(n+1, INT_MAX);
-  prev_memo[s] = 0;
-
-  for (int i = 1; i < n + 1; ++i) {
-    std::fill(memo.begin(), memo.end(), INT_MAX);
-
-    for (int w = s; w >= 0; w--) {
-      auto min_path = prev_memo[w];
-      auto const &neighbours = graph_rev[w];
-      for (auto iter = neighbours.cbegin(); iter != neighbours.cend(); ++iter) {
-        auto const &e = *iter;
-        if (prev_memo[e.v] == INT_MAX)
-          continue;
-        min_path = std::min(min_path, prev_memo[e.v] + e.r);
-      }
-      memo[w] = min_path;
-    }
-    prev_memo.swap(memo);
-  }
-
-  std::vector<int> scores(n);
-  for (int i = 0; i < n; i++) {
-    if (prev_memo[i] != memo[i]) {
-      return bellman_ford_result_type(std::vector<int>(), false);
-    }
-    scores[i] = memo[i];
-  }
-  return bellman_ford_result_type(scores, true);
-}
+// What one worker keeps between sources: Dijkstra's distances and heap,
+// allocated once and reused, and the shortest path it has seen so far.
+// On a line of its own, so that workers never write to a shared one.
+struct alignas(64) Worker {
+  std::vector<int> dists;
+  std::vector<Dist> heap;
+  int shortest_path = INT_MAX;
+};
 
-auto dijkstra(int n, int m,
-              std::deque<std::vector<Edge>> const &edges, int s)
-  -> std::vector<int> {
-  std::vector<int> dists(n, INT_MAX);
+auto dijkstra(Graph const &graph, int s, Worker &worker) -> void {
+  auto &dists = worker.dists;
+  auto &heap = worker.heap;
+  std::fill(dists.begin(), dists.end(), INT_MAX);
   dists[s] = 0;
 
-  std::priority_queue<Dist, std::vector<Dist>, std::greater<Dist>> queue;
-  queue.emplace(s, dists[s]);
+  heap.clear();
+  heap.emplace_back(s, dists[s]);
 
-  while (!queue.empty()) {
-    Dist min_dist = queue.top();
-    queue.pop();
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), std::greater<Dist>());
+    Dist const min_dist = heap.back();
+    heap.pop_back();
 
     int const u = min_dist.v;
     if (dists[u] < min_dist.d) {
       continue;
     }
 
-    auto const &neighbours = edges[u];
-    for (auto iter = neighbours.cbegin(); iter != neighbours.cend(); ++iter) {
-      int v = iter->v;
-      int alt = dists[u] + iter->r;
+    for (auto const [v, r] : graph.out(u)) {
+      int alt = dists[u] + r;
       if (alt < dists[v]) {
         dists[v] = alt;
-        queue.emplace(v, alt);
+        heap.emplace_back(v, alt);
+        std::push_heap(heap.begin(), heap.end(), std::greater<Dist>());
       }
     }
   }
-
-  return dists;
 }
 
-auto johnson() -> void {
+auto johnson(unsigned nthreads) -> void {
   // Read N and M.
   int n, m;
   scanf("%d %d", &n, &m);
     
   // Read edges.
-  std::deque<std::vector<Edge>> graph(n);
+  std::vector<graph::Edge<int>> edges;
+  edges.reserve(m + n);
   for (int i = 0; i < m; i++) {
     int u, v, r;
     scanf("%d %d %d", &u, &v, &r);
     u--;
     v--;
-    graph[u].push_back(Edge(v, r));
+    edges.push_back({graph::vertex_type(u), graph::vertex_type(v), r});
   }
 
-  // Add a helper vertix and bind it with every vertices of the graph.
-  {
-    std::vector<Edge> helper_edges;
-    helper_edges.reserve(n);
-    for (int v = 0; v < n; v++) {
-      helper_edges.push_back(Edge(v, 0));
-    }
-    graph.push_back(std::move(helper_edges));
+  // Run Bellman-Ford algorithm from a helper vertix bound with every
+  // vertices of the graph.
+  for (int v = 0; v < n; v++) {
+    edges.push_back({graph::vertex_type(n), graph::vertex_type(v), 0});
   }
-
-  // Run Bellman-Ford algorithm.
-  auto bf_result = bellman_ford(n, m, graph, n);
-  if (!bf_result.second) {
+  simd::ThreadPool pool(nthreads);
+  auto bf_result = graph::bellman_ford(Graph(n + 1, edges), graph::vertex_type(n),
+                                       graph::BellmanFord::Frontier, &pool);
+  edges.resize(m);
+  if (bf_result.negative_cycle) {
     fprintf(stderr, "negative cycle detected\n");
     return;
   }
-  auto scores = std::move(bf_result.first);
-
-  // Remove the helper vertix.
-  graph.erase(graph.begin() + n);
+  auto const &scores = bf_result.dist;
 
   // Reweight the graph to get rid of negative edges.
+  Graph graph(n, edges);
+  auto const offsets = graph.offsets();
+  auto const targets = graph.targets();
+  auto const weights = graph.weights();
   for (int u = 0; u < n; u++) {
-    for (auto it = graph[u].begin(); it != graph[u].end(); ++it) {
-      // printf("u=%d, v=%d");
-      it->r += scores[u] - scores[it->v];
-      assert(it->r >= 0);
+    for (auto e = offsets[u]; e < offsets[u + 1]; ++e) {
+      weights[e] += scores[u] - scores[targets[e]];
+      assert(weights[e] >= 0);
     }
   }
 
-  // Run Dijstra algrotihm for each pair of vertices and find the shortest path.
-  int shortest_path = INT_MAX;
-  for (int u = 0; u < n; u++) {
-    auto const dists = dijkstra(n, m, graph, u);
+  // Run Dijstra algrotihm from each vertex and find the shortest path.
+  // Sources go to the workers of a pool, a worker that runs out stealing
+  // from one that has not, and each folds its distances into its own
+  // minimum as soon as they are known: no row outlives its source.
+  std::vector<Worker> workers(pool.size());
+  for (auto &worker : workers) {
+    worker.dists.resize(n);
+    worker.heap.reserve(n);
+  }
+  std::atomic<int> done{0};
+  simd::for_each_stealing(pool, n, [&](unsigned w, std::size_t s) {
+    auto &worker = workers[w];
+    int const u = int(s);
+    dijkstra(graph, u, worker);
     for (int v = 0; v < n; v++) {
-      auto const d = dists[v];
+      auto const d = worker.dists[v];
       if (d == INT_MAX)
         continue;
-      shortest_path = std::min(shortest_path,
-                               d + scores[v] - scores[u]);
+      worker.shortest_path = std::min(worker.shortest_path,
+                                      d + scores[v] - scores[u]);
     }
-    if (u % 10 == 0) {
-      printf("dijkstra progress: %f\r", float(u)/float(n));
+    auto const finished = done.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (finished % 10 == 0) {
+      printf("dijkstra progress: %f\r", float(finished)/float(n));
     }
-  }
+  });
   printf("dijkstra progress: %f\n", 1.0f);
 
+  int shortest_path = INT_MAX;
+  for (auto const &worker : workers)
+    shortest_path = std::min(shortest_path, worker.shortest_path);
+
   printf("Shortest path is %i\n", shortest_path);
 }
 
-int main() {
-  johnson();
+// johnson [threads]: all of the machine's CPUs by default.
+int main(int argc, char **argv) {
+  unsigned const nthreads = argc > 1
+    ? unsigned(std::strtoul(argv[1], nullptr, 10))
+    : std::thread::hardware_concurrency();
+  johnson(nthreads);
 
   return 0;
 }
 
+// % g++ -std=c++17 -O2 -pthread johnson.cxx ../../vectorization/thread_pool.cxx -o johnson
+// (one thread, before the sources were spread over a pool:)
 // % g++ -std=c++14 -Ofast -mtune=native johnson.cxx -o johnson && cat large.txt | time ./johnson
 // Shortest path is -60.999500
 // ./johnson  412.79s user 4.01s system 96% cpu 7:12.25 total
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#if defined(__linux__)
+# include <sys/mman.h>
+#elif defined(_WIN32)
+# if !defined(NOMINMAX)
+#  define NOMINMAX
+# endif
+# if !defined(WIN32_LEAN_AND_MEAN)
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+#endif
+
+#include "arena.hxx"
+#include "parallel.hxx"
+
+namespace simd {
+
+namespace {
+
+constexpr std::size_t page = 4096;
+
+std::size_t round_up(std::size_t n, std::size_t align) noexcept {
+  return (n + align - 1) / align * align;
+}
+
+}  // namespace
+
+Arena::Arena(std::size_t reserve, Pages pages, ThreadPool* pool)
+  : reserved_(round_up(reserve, huge_page))
+  , pool_(pool) {
+#if defined(__linux__)
+  // Over-reserve by one huge page and start at the first 2 MiB boundary, so
+  // every huge page of the arena can be backed by a real one.
+  mapping_size_ = reserved_ + huge_page;
+  mapping_ = mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (mapping_ == MAP_FAILED) {
+    mapping_ = nullptr;
+    throw std::bad_alloc();
+  }
+  auto const addr = reinterpret_cast<std::uintptr_t>(mapping_);
+  base_ = reinterpret_cast<std::uint8_t*>(round_up(addr, huge_page));
+  if (pages == Pages::Huge)
+    huge_ = madvise(base_, reserved_, MADV_HUGEPAGE) == 0;
+#elif defined(_WIN32)
+  // Address space only, aligned as on Linux; fault() commits pages as
+  // allocations reach them.
+  (void)pages;
+  mapping_size_ = reserved_ + huge_page;
+  mapping_ = VirtualAlloc(nullptr, mapping_size_, MEM_RESERVE, PAGE_NOACCESS);
+  if (!mapping_)
+    throw std::bad_alloc();
+  auto const addr = reinterpret_cast<std::uintptr_t>(mapping_);
+  base_ = reinterpret_cast<std::uint8_t*>(round_up(addr, huge_page));
+#else
+  (void)pages;
+  mapping_size_ = reserved_;
+  mapping_ = operator new[](reserved_, std::align_val_t{huge_page});
+  base_ = static_cast<std::uint8_t*>(mapping_);
+#endif
+}
+
+Arena::~Arena() {
+#if defined(__linux__)
+  if (mapping_)
+    munmap(mapping_, mapping_size_);
+#elif defined(_WIN32)
+  if (mapping_)
+    VirtualFree(mapping_, 0, MEM_RELEASE);
+#else
+  operator delete[](mapping_, std::align_val_t{huge_page});
+#endif
+}
+
+void* Arena::allocate(std::size_t bytes, std::size_t align) {
+  auto const begin = round_up(used_, align);
+  if (begin > reserved_ || bytes > reserved_ - begin)
+    throw std::bad_alloc();
+
+  auto const end = begin + bytes;
+  if (end > faulted_)
+    fault(end);
+  used_ = end;
+  return base_ + begin;
+}
+
+// Writes one byte per 4 KiB page in [faulted_, end), rounded out to whole
+// huge pages when they are in use, so the kernel backs the range before
+// any kernel runs over it.  Windows needs the range committed first.
+void Arena::fault(std::size_t end) {
+  end = std::min(round_up(end, huge_ ? huge_page : page), reserved_);
+  auto* const begin = base_ + faulted_;
+  auto const n = end - faulted_;
+#if defined(_WIN32)
+  if (!VirtualAlloc(begin, n, MEM_COMMIT, PAGE_READWRITE))
+    throw std::bad_alloc();
+#endif
+
+  auto touch = [begin](std::size_t from, std::size_t to) {
+    for (auto i = from; i < to; i += page)
+      begin[i] = 0;
+  };
+  if (pool_) {
+    for_each_band(*pool_, n, touch);
+  } else {
+    touch(0, n);
+  }
+  faulted_ = end;
+}
+
+}  // namespace simd
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "thread_pool.hxx"
+
+namespace simd {
+
+// A bump allocator over one reserved, 2 MiB aligned range of address space.
+// Pages are faulted in when a slab first reaches them, before allocate()
+// returns, and stay faulted across reset(); a benchmark that resets and
+// allocates the same sizes again gets warm memory, with no page faults in
+// its timed loop.
+class Arena {
+public:
+  enum class Pages {
+    // Regular pages.
+    Normal,
+    // Transparent huge pages via madvise(MADV_HUGEPAGE), where the kernel
+    // allows them: one TLB entry per 2 MiB instead of per 4 KiB.
+    Huge,
+  };
+
+  static constexpr std::size_t huge_page = std::size_t{2} << 20;
+
+  // Reserves `reserve` bytes of address space; only the pages allocations
+  // reach are ever backed.  With a pool, fresh pages are first touched by
+  // its workers band by band (see first_touch()), so each band lands on
+  // the NUMA node of the worker that will process it; a huge page that
+  // straddles two bands goes to whichever worker touches it first.
+  explicit Arena(std::size_t reserve, Pages pages = Pages::Huge,
+                 ThreadPool* pool = nullptr);
+  ~Arena();
+
+  Arena(Arena const&) = delete;
+  Arena& operator = (Arena const&) = delete;
+
+  // `bytes` bytes aligned to `align` (a power of two, at most huge_page),
+  // pre-faulted.  Throws std::bad_alloc once the reservation is exhausted.
+  void* allocate(std::size_t bytes, std::size_t align = 64);
+
+  template <typename T>
+  T* allocate(std::size_t n, std::size_t align = 64) {
+    return static_cast<T*>(allocate(n * sizeof(T), align));
+  }
+
+  // Releases every allocation at once.  The pages stay mapped and faulted.
+  void reset() noexcept { used_ = 0; }
+
+  std::size_t reserved() const noexcept { return reserved_; }
+  std::size_t used() const noexcept { return used_; }
+  // Bytes faulted in so far: the high-water mark of used().
+  std::size_t faulted() const noexcept { return faulted_; }
+  // Whether the kernel accepted the huge page advice.
+  bool huge_pages() const noexcept { return huge_; }
+
+private:
+  void fault(std::size_t end);
+
+  std::uint8_t* base_ = nullptr;
+  std::size_t reserved_ = 0;
+  std::size_t used_ = 0;
+  std::size_t faulted_ = 0;
+  void* mapping_ = nullptr;
+  std::size_t mapping_size_ = 0;
+  ThreadPool* pool_ = nullptr;
+  bool huge_ = false;
+};
+
+}  // namespace simd
@@ -5,8 +5,6 @@
 # include <intrin.h>
 #endif
 
-namespace {
-  
 inline void run_cpuid(std::uint32_t eax, std::uint32_t ecx, std::uint32_t* abcd) {
 #if defined(_MSC_VER)
   int abcd_[4];
@@ -30,16 +28,172 @@ inline void run_cpuid(std::uint32_t eax, std::uint32_t ecx, std::uint32_t* abcd)
 #endif
 }
 
-inline bool has_avx512() {
-  std::uint32_t constexpr avx512_f = 1 << 16;
-  std::uint32_t constexpr avx512_bw = 1 << 30;
+// Only valid when CPUID reports OSXSAVE.
+inline std::uint64_t run_xgetbv(std::uint32_t index) {
+#if defined(_MSC_VER)
+  return _xgetbv(index);
+#else
+  std::uint32_t eax, edx;
+  // Spelled as an opcode so no -mxsave is needed.
+  __asm__ (".byte 0x0f, 0x01, 0xd0" : "=a" (eax), "=d" (edx) : "c" (index));
+  return (std::uint64_t{edx} << 32) | eax;
+#endif
+}
+
+// A snapshot of what both the CPU and the OS support.  AVX and AVX-512 flags
+// are only set when XCR0 shows the OS saves the corresponding register state.
+struct CpuFeatures {
+  bool sse42 = false;
+  bool avx = false;
+  bool avx2 = false;
+  bool fma = false;
+  bool bmi2 = false;
+  bool avx512f = false;
+  bool avx512bw = false;
+  bool avx512vl = false;
+  bool avx512vnni = false;
+
+  // Bytes; 0 when not reported.
+  std::uint32_t cache_line = 0;
+  std::uint32_t l1d_size = 0;
+  std::uint32_t l2_size = 0;
+  std::uint32_t l3_size = 0;
+
+  // Per package; 0 when not reported.
+  std::uint32_t logical_cpus = 0;
+  std::uint32_t cores = 0;
+  std::uint32_t threads_per_core = 0;
+
+  // Size of the last level of cache.
+  std::uint32_t llc_size() const noexcept {
+    return l3_size ? l3_size : l2_size ? l2_size : l1d_size;
+  }
+};
+
+namespace cpuid_detail {
+
+inline bool bit(std::uint32_t reg, unsigned n) {
+  return (reg >> n) & 1;
+}
+
+// Leaf 4 (Intel) and leaf 0x8000001d (AMD) share one layout.
+inline void read_cache_leaf(std::uint32_t leaf, CpuFeatures& f) {
+  for (std::uint32_t sub = 0; sub < 16; ++sub) {
+    std::uint32_t abcd[4];
+    run_cpuid(leaf, sub, abcd);
+
+    auto const type = abcd[0] & 0x1f;
+    if (type == 0)
+      break;
+    if (type == 2)  // instruction cache
+      continue;
+
+    auto const level = (abcd[0] >> 5) & 0x7;
+    auto const line = (abcd[1] & 0xfff) + 1;
+    auto const partitions = ((abcd[1] >> 12) & 0x3ff) + 1;
+    auto const ways = ((abcd[1] >> 22) & 0x3ff) + 1;
+    auto const sets = abcd[2] + 1;
+    auto const size = ways * partitions * line * sets;
+
+    switch (level) {
+    case 1: f.l1d_size = size; f.cache_line = line; break;
+    case 2: f.l2_size = size; break;
+    case 3: f.l3_size = size; break;
+    }
+  }
+}
+
+inline void read_topology(std::uint32_t max_leaf, bool htt, std::uint32_t leaf1_ebx,
+                          CpuFeatures& f) {
+  // Leaf 0xb level 0 counts threads per core, level 1 threads per package.
+  if (max_leaf >= 0xb) {
+    std::uint32_t smt[4], core[4];
+    run_cpuid(0xb, 0, smt);
+    run_cpuid(0xb, 1, core);
+    if ((smt[1] & 0xffff) != 0 && (core[1] & 0xffff) != 0) {
+      f.threads_per_core = smt[1] & 0xffff;
+      f.logical_cpus = core[1] & 0xffff;
+      f.cores = f.logical_cpus / f.threads_per_core;
+      return;
+    }
+  }
+
+  f.logical_cpus = htt ? (leaf1_ebx >> 16) & 0xff : 1;
+  if (max_leaf >= 4) {
+    std::uint32_t abcd[4];
+    run_cpuid(4, 0, abcd);
+    f.cores = (abcd[0] >> 26) + 1;
+  }
+  if (f.cores == 0 || f.cores > f.logical_cpus)
+    f.cores = f.logical_cpus;
+  f.threads_per_core = f.cores ? f.logical_cpus / f.cores : 0;
+}
+
+inline CpuFeatures detect_cpu_features() {
+  CpuFeatures f;
 
   std::uint32_t abcd[4];
+  run_cpuid(0, 0, abcd);
+  auto const max_leaf = abcd[0];
+  run_cpuid(0x80000000, 0, abcd);
+  auto const max_ext_leaf = abcd[0];
+
+  if (max_leaf < 1)
+    return f;
+
+  std::uint32_t leaf1[4];
+  run_cpuid(1, 0, leaf1);
+
+  std::uint64_t xcr0 = 0;
+  if (bit(leaf1[2], 27))  // OSXSAVE
+    xcr0 = run_xgetbv(0);
+  bool const os_avx = (xcr0 & 0x06) == 0x06;        // XMM, YMM
+  bool const os_avx512 = os_avx && (xcr0 & 0xe0) == 0xe0;  // opmask, ZMM
+
+  f.sse42 = bit(leaf1[2], 20);
+  f.avx = os_avx && bit(leaf1[2], 28);
+  f.fma = f.avx && bit(leaf1[2], 12);
+  f.cache_line = ((leaf1[1] >> 8) & 0xff) * 8;
+
+  if (max_leaf >= 7) {
+    std::uint32_t leaf7[4];
+    run_cpuid(7, 0, leaf7);
+
+    f.avx2 = f.avx && bit(leaf7[1], 5);
+    f.bmi2 = bit(leaf7[1], 8);
+    f.avx512f = os_avx512 && bit(leaf7[1], 16);
+    f.avx512bw = f.avx512f && bit(leaf7[1], 30);
+    f.avx512vl = f.avx512f && bit(leaf7[1], 31);
+    f.avx512vnni = f.avx512f && bit(leaf7[2], 11);
+  }
 
-  run_cpuid(7, 0, abcd);
+  if (max_leaf >= 4)
+    read_cache_leaf(4, f);
+  if (f.l1d_size == 0 && max_ext_leaf >= 0x8000001d)
+    read_cache_leaf(0x8000001d, f);
 
-  std::uint32_t need = avx512_f | avx512_bw;
-  return (abcd[1] & need) == need;
+  read_topology(max_leaf, bit(leaf1[3], 28), leaf1[1], f);
+
+  return f;
 }
 
+}  // namespace cpuid_detail
+
+// Detected on first use; CPUID serialises the pipeline, so hot paths should
+// keep going through this instead of calling run_cpuid().
+inline CpuFeatures const& cpu_features() noexcept {
+  static CpuFeatures const features = cpuid_detail::detect_cpu_features();
+  return features;
+}
+
+inline bool has_sse42() {
+  return cpu_features().sse42;
+}
+
+inline bool has_avx2() {
+  return cpu_features().avx2;
+}
+
+inline bool has_avx512() {
+  return cpu_features().avx512f && cpu_features().avx512bw;
 }
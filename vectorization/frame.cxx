@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "frame.hxx"
+#include "simd.hxx"
+
+#if defined(__GNUC__) && !defined(__clang__)
+# pragma GCC push_options
+# pragma GCC optimize ("O2,tree-vectorize")
+#endif
+
+#include "frame_detail.hxx"
+
+namespace simd {
+
+namespace detail {
+
+namespace {
+
+// One pixel per "register", as in the scalar byte kernels.
+struct Frame {
+  using wide = std::int16_t;
+  using acc = std::int32_t;
+  static constexpr std::size_t wlanes = 1;
+
+  static wide widen(std::uint8_t const* p) { return *p; }
+  static wide loadw(std::int16_t const* p) { return *p; }
+  static void storew(std::int16_t* p, wide v) { *p = v; }
+  static wide setw(std::int16_t k) { return k; }
+  static wide mulw(wide a, wide b) { return static_cast<wide>(a * b); }
+  static wide addw(wide a, wide b) { return static_cast<wide>(a + b); }
+
+  static acc acc_init(std::int32_t round) { return round; }
+  struct pair { std::int16_t a, b; };
+  static pair make_pair(std::int16_t ka, std::int16_t kb) { return {ka, kb}; }
+  static acc mac2(acc sum, wide a, wide b, pair k) {
+    return sum + a * k.a + b * k.b;
+  }
+  static void narrow(std::uint8_t* p, acc sum, unsigned shift) {
+    *p = static_cast<std::uint8_t>(std::clamp(sum >> shift, 0, 255));
+  }
+};
+
+// The same tile walk as the vector transpose, one byte at a time.
+void scalar_transpose(std::uint8_t* dst, std::size_t dst_stride,
+                      std::uint8_t const* src, std::size_t src_stride,
+                      std::size_t rows, std::size_t cols) {
+  constexpr std::size_t block = 16;
+  for (std::size_t r0 = 0; r0 < rows; r0 += block) {
+    auto const r1 = std::min(r0 + block, rows);
+    for (std::size_t c0 = 0; c0 < cols; c0 += block) {
+      auto const c1 = std::min(c0 + block, cols);
+      for (std::size_t c = c0; c < c1; ++c) {
+        for (std::size_t r = r0; r < r1; ++r)
+          dst[c * dst_stride + r] = src[r * src_stride + c];
+      }
+    }
+  }
+}
+
+}  // namespace
+
+FrameKernels const scalar_frame_kernels = {
+  scalar_transpose,
+  convolve<Frame, 3>,
+  convolve<Frame, 5>,
+};
+
+}  // namespace detail
+
+#if defined(__GNUC__) && !defined(__clang__)
+# pragma GCC pop_options
+#endif
+
+FrameKernels const* frame_kernels(Isa isa) noexcept {
+  if (!isa_supported(isa))
+    return nullptr;
+  switch (isa) {
+  case Isa::Scalar:
+    return &detail::scalar_frame_kernels;
+#if defined(SIMD_BUILD_SSE42)
+  case Isa::SSE42:
+    return &detail::sse42_frame_kernels;
+#endif
+#if defined(SIMD_BUILD_AVX2)
+  case Isa::AVX2:
+    return &detail::avx2_frame_kernels;
+#endif
+#if defined(SIMD_BUILD_AVX512)
+  case Isa::AVX512:
+    return &detail::avx512_frame_kernels;
+#endif
+  default:
+    return nullptr;
+  }
+}
+
+FrameKernels const& frame_kernels() noexcept {
+  static FrameKernels const& best = *frame_kernels(best_isa());
+  return best;
+}
+
+}  // namespace simd
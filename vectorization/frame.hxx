@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "simd.hxx"
+
+namespace simd {
+
+// Kernels over 2-D byte frames: `rows` rows of `cols` bytes, each row
+// starting `stride` bytes after the previous one.  Frames must not overlap.
+struct FrameKernels {
+  // dst (cols x rows) = src (rows x cols) transposed.  Works on 16x16 byte
+  // blocks held in registers, within tiles that keep both the source and
+  // the destination lines in L1.
+  void (*transpose)(std::uint8_t* dst, std::size_t dst_stride,
+                    std::uint8_t const* src, std::size_t src_stride,
+                    std::size_t rows, std::size_t cols);
+
+  // Separable 3x3 and 5x5 filters with integer taps, replicating the edge
+  // pixels:
+  //   dst = saturate_u8((sum_i ky[i] * sum_j kx[j] * src + round) >> shift)
+  // The row pass is kept in 16 bits, so sum(|kx|) * 255 must fit an
+  // int16_t; the column pass accumulates in 32 bits.
+  void (*convolve3)(std::uint8_t* dst, std::size_t dst_stride,
+                    std::uint8_t const* src, std::size_t src_stride,
+                    std::size_t rows, std::size_t cols,
+                    std::int16_t const* kx, std::int16_t const* ky,
+                    unsigned shift);
+  void (*convolve5)(std::uint8_t* dst, std::size_t dst_stride,
+                    std::uint8_t const* src, std::size_t src_stride,
+                    std::size_t rows, std::size_t cols,
+                    std::int16_t const* kx, std::int16_t const* ky,
+                    unsigned shift);
+};
+
+// Kernels for `isa`, or nullptr when !isa_supported(isa).
+FrameKernels const* frame_kernels(Isa isa) noexcept;
+
+// Kernels for best_isa().
+FrameKernels const& frame_kernels() noexcept;
+
+inline void transpose(std::uint8_t* dst, std::size_t dst_stride,
+                      std::uint8_t const* src, std::size_t src_stride,
+                      std::size_t rows, std::size_t cols) {
+  frame_kernels().transpose(dst, dst_stride, src, src_stride, rows, cols);
+}
+
+inline void convolve3(std::uint8_t* dst, std::size_t dst_stride,
+                      std::uint8_t const* src, std::size_t src_stride,
+                      std::size_t rows, std::size_t cols,
+                      std::int16_t const (&kx)[3], std::int16_t const (&ky)[3],
+                      unsigned shift) {
+  frame_kernels().convolve3(dst, dst_stride, src, src_stride, rows, cols,
+                            kx, ky, shift);
+}
+
+inline void convolve5(std::uint8_t* dst, std::size_t dst_stride,
+                      std::uint8_t const* src, std::size_t src_stride,
+                      std::size_t rows, std::size_t cols,
+                      std::int16_t const (&kx)[5], std::int16_t const (&ky)[5],
+                      unsigned shift) {
+  frame_kernels().convolve5(dst, dst_stride, src, src_stride, rows, cols,
+                            kx, ky, shift);
+}
+
+}  // namespace simd
@@ -0,0 +1,221 @@
+#pragma once
+
+// Internal to the simd library.
+//
+// Every ISA translation unit that builds frame kernels defines a `Frame`
+// type and instantiates the loops below with it:
+//   - for the transpose, a register of `blocks` side-by-side 16-byte lanes,
+//     with in-lane unpacks at every element width, and store_blocks() that
+//     writes lane k to p + k * block_stride;
+//   - for the convolution, `wide` registers of `wlanes` int16 values, an
+//     `acc` holding the 32-bit column sums of one wide register, and a
+//     `pair` of column taps applied to two rows at once.
+// Like simd_detail.hxx, include this header after the unit's
+// SIMD_TARGET_PUSH().
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "frame.hxx"
+#include "simd_detail.hxx"
+#include "target.hxx"
+
+namespace simd::detail {
+
+extern FrameKernels const scalar_frame_kernels;
+#if defined(SIMD_BUILD_SSE42)
+extern FrameKernels const sse42_frame_kernels;
+#endif
+#if defined(SIMD_BUILD_AVX2)
+extern FrameKernels const avx2_frame_kernels;
+#endif
+#if defined(SIMD_BUILD_AVX512)
+extern FrameKernels const avx512_frame_kernels;
+#endif
+
+namespace {
+
+// Side of the square tiles the transpose walks: 16 KiB of source and 16 KiB
+// of destination, which stay in L1 while the tile's blocks are swapped.
+constexpr std::size_t transpose_tile = 128;
+
+// Transposes the 16 x (16 * blocks) bytes at src into dst.  Four rounds of
+// unpacks, pairing register i with register i + 8 and doubling the element
+// width each time, turn the 16 rows of each 16-byte lane into its 16
+// columns.  The rounds leave the rows of every column in bit-reversed
+// order, so the rows are loaded in bit-reversed order to begin with.
+template <typename F>
+void transpose_block(std::uint8_t* dst, std::size_t dst_stride,
+                     std::uint8_t const* src, std::size_t src_stride) {
+  constexpr std::size_t reversed[16] = {
+    0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15,
+  };
+  typename F::reg x[16];
+  typename F::reg t[16];
+  SIMD_UNROLL(16)
+  for (int i = 0; i < 16; ++i)
+    x[i] = F::loadu(src + reversed[i] * src_stride);
+  SIMD_UNROLL(8)
+  for (int i = 0; i < 8; ++i) {
+    t[2 * i] = F::unpacklo8(x[i], x[i + 8]);
+    t[2 * i + 1] = F::unpackhi8(x[i], x[i + 8]);
+  }
+  SIMD_UNROLL(8)
+  for (int i = 0; i < 8; ++i) {
+    x[2 * i] = F::unpacklo16(t[i], t[i + 8]);
+    x[2 * i + 1] = F::unpackhi16(t[i], t[i + 8]);
+  }
+  SIMD_UNROLL(8)
+  for (int i = 0; i < 8; ++i) {
+    t[2 * i] = F::unpacklo32(x[i], x[i + 8]);
+    t[2 * i + 1] = F::unpackhi32(x[i], x[i + 8]);
+  }
+  SIMD_UNROLL(8)
+  for (int i = 0; i < 8; ++i) {
+    x[2 * i] = F::unpacklo64(t[i], t[i + 8]);
+    x[2 * i + 1] = F::unpackhi64(t[i], t[i + 8]);
+  }
+  SIMD_UNROLL(16)
+  for (std::size_t j = 0; j < 16; ++j)
+    F::store_blocks(dst + j * dst_stride, 16 * dst_stride, x[j]);
+}
+
+// A block cut by the frame edge goes through a zero-padded copy.
+template <typename F>
+void transpose_edge(std::uint8_t* dst, std::size_t dst_stride,
+                    std::uint8_t const* src, std::size_t src_stride,
+                    std::size_t rows, std::size_t cols) {
+  constexpr std::size_t width = 16 * F::blocks;
+  alignas(64) std::uint8_t in[16 * width] = {};
+  alignas(64) std::uint8_t out[width * 16];
+  for (std::size_t r = 0; r < rows; ++r)
+    std::memcpy(in + r * width, src + r * src_stride, cols);
+  transpose_block<F>(out, 16, in, width);
+  for (std::size_t c = 0; c < cols; ++c)
+    std::memcpy(dst + c * dst_stride, out + c * 16, rows);
+}
+
+template <typename F>
+void transpose(std::uint8_t* dst, std::size_t dst_stride,
+               std::uint8_t const* src, std::size_t src_stride,
+               std::size_t rows, std::size_t cols) {
+  constexpr std::size_t width = 16 * F::blocks;
+  static_assert(transpose_tile % width == 0);
+
+  for (std::size_t r0 = 0; r0 < rows; r0 += transpose_tile) {
+    auto const r1 = std::min(r0 + transpose_tile, rows);
+    for (std::size_t c0 = 0; c0 < cols; c0 += transpose_tile) {
+      auto const c1 = std::min(c0 + transpose_tile, cols);
+      for (std::size_t r = r0; r < r1; r += 16) {
+        for (std::size_t c = c0; c < c1; c += width) {
+          auto* d = dst + c * dst_stride + r;
+          auto const* s = src + r * src_stride + c;
+          if (r + 16 <= rows && c + width <= cols) {
+            transpose_block<F>(d, dst_stride, s, src_stride);
+          } else {
+            transpose_edge<F>(d, dst_stride, s, src_stride,
+                              std::min<std::size_t>(16, rows - r),
+                              std::min(width, cols - c));
+          }
+        }
+      }
+    }
+  }
+}
+
+// Separable K x K filter.  Each source row is filtered horizontally once,
+// into a ring of the last K row-pass results; every output row then sums K
+// ring rows.  Rows and columns past the frame edge repeat the edge pixels.
+template <typename F, std::size_t K>
+void convolve(std::uint8_t* dst, std::size_t dst_stride,
+              std::uint8_t const* src, std::size_t src_stride,
+              std::size_t rows, std::size_t cols,
+              std::int16_t const* kx, std::int16_t const* ky,
+              unsigned shift) {
+  if (rows == 0 || cols == 0)
+    return;
+
+  constexpr std::size_t radius = K / 2;
+  constexpr std::size_t lanes = F::wlanes;
+  // The row pass covers whole registers; the padded row holds every byte
+  // its loads touch.
+  auto const width = (cols + lanes - 1) / lanes * lanes;
+  std::vector<std::uint8_t> padded(width + K - 1);
+  std::vector<std::int16_t> ring(K * width);
+
+  // Broadcast once: the byte stores below may alias the taps, so the
+  // compiler would otherwise reload and rebroadcast them every iteration.
+  typename F::wide wkx[K];
+  for (std::size_t j = 0; j < K; ++j)
+    wkx[j] = F::setw(kx[j]);
+  typename F::pair kpairs[(K + 1) / 2];
+  for (std::size_t i = 0; i < K; i += 2)
+    kpairs[i / 2] = F::make_pair(ky[i], i + 1 < K ? ky[i + 1] : 0);
+
+  auto row_pass = [&](std::size_t y) {
+    auto const* s = src + y * src_stride;
+    auto* p = padded.data();
+    std::memset(p, s[0], radius);
+    std::memcpy(p + radius, s, cols);
+    std::memset(p + radius + cols, s[cols - 1], padded.size() - radius - cols);
+
+    auto* out = ring.data() + y % K * width;
+    for (std::size_t x = 0; x < width; x += lanes) {
+      auto sum = F::mulw(F::widen(p + x), wkx[0]);
+      SIMD_UNROLL(4)
+      for (std::size_t j = 1; j < K; ++j)
+        sum = F::addw(sum, F::mulw(F::widen(p + x + j), wkx[j]));
+      F::storew(out + x, sum);
+    }
+  };
+
+  auto const round = shift ? std::int32_t{1} << (shift - 1) : 0;
+  std::size_t next = 0;
+  for (std::size_t y = 0; y < rows; ++y) {
+    for (auto const last = std::min(y + radius, rows - 1); next <= last; ++next)
+      row_pass(next);
+
+    std::int16_t const* in[K];
+    for (std::size_t i = 0; i < K; ++i) {
+      auto const yy = std::min(std::max(y + i, radius) - radius, rows - 1);
+      in[i] = ring.data() + yy % K * width;
+    }
+
+    auto column_pass = [&](std::size_t x) {
+      auto acc = F::acc_init(round);
+      std::size_t i = 0;
+      SIMD_UNROLL(2)
+      for (; i + 1 < K; i += 2) {
+        acc = F::mac2(acc, F::loadw(in[i] + x), F::loadw(in[i + 1] + x),
+                      kpairs[i / 2]);
+      }
+      return F::mac2(acc, F::loadw(in[i] + x), F::setw(0), kpairs[i / 2]);
+    };
+
+    auto* d = dst + y * dst_stride;
+    std::size_t x = 0;
+    for (; x + lanes <= cols; x += lanes)
+      F::narrow(d + x, column_pass(x), shift);
+    if (x < cols) {
+      alignas(64) std::uint8_t t[lanes];
+      F::narrow(t, column_pass(x), shift);
+      std::memcpy(d + x, t, cols - x);
+    }
+  }
+}
+
+template <typename F>
+constexpr FrameKernels make_frame_kernels() noexcept {
+  return {
+    transpose<F>,
+    convolve<F, 3>,
+    convolve<F, 5>,
+  };
+}
+
+}  // namespace
+
+}  // namespace simd::detail
@@ -0,0 +1,111 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "min_plus.hxx"
+#include "min_plus_detail.hxx"
+#include "thread_pool.hxx"
+#include "work_stealing.hxx"
+
+namespace simd {
+
+namespace {
+
+// Tile (i, j) of the matrix at m.
+template <typename T>
+T* tile(T* m, std::size_t stride, std::size_t i, std::size_t j) noexcept {
+  return m + (i * stride + j) * min_plus_tile;
+}
+
+}  // namespace
+
+MinPlusKernels const* min_plus_kernels(Isa isa) noexcept {
+  if (!isa_supported(isa))
+    return nullptr;
+  switch (isa) {
+  case Isa::Scalar:
+    return &detail::scalar_min_plus_kernels;
+#if defined(SIMD_BUILD_SSE42)
+  case Isa::SSE42:
+    return &detail::sse42_min_plus_kernels;
+#endif
+#if defined(SIMD_BUILD_AVX2)
+  case Isa::AVX2:
+    return &detail::avx2_min_plus_kernels;
+#endif
+#if defined(SIMD_BUILD_AVX512)
+  case Isa::AVX512:
+    return &detail::avx512_min_plus_kernels;
+#endif
+  default:
+    return nullptr;
+  }
+}
+
+MinPlusKernels const& min_plus_kernels() noexcept {
+  static MinPlusKernels const& best = *min_plus_kernels(best_isa());
+  return best;
+}
+
+void min_plus_product(ThreadPool& pool, std::int32_t* c, std::int32_t const* a,
+                      std::int32_t const* b, std::size_t n, std::size_t stride,
+                      MinPlusKernels const& kernels) {
+  auto const tiles = n / min_plus_tile;
+  for_each_stealing(pool, tiles * tiles, [&](unsigned, std::size_t task) {
+    auto const i = task / tiles, j = task % tiles;
+    auto* const cij = tile(c, stride, i, j);
+    for (std::size_t k = 0; k < tiles; ++k)
+      kernels.multiply(cij, tile(a, stride, i, k), tile(b, stride, k, j), stride);
+  });
+}
+
+void min_plus_closure(ThreadPool& pool, std::int32_t* d, std::size_t n,
+                      std::size_t stride, MinPlusKernels const& kernels) {
+  auto const tiles = n / min_plus_tile;
+  for (std::size_t t = 0; t < tiles; ++t) {
+    auto* const diagonal = tile(d, stride, t, t);
+    kernels.close(diagonal, diagonal, diagonal, stride);
+
+    for_each_stealing(pool, 2 * tiles, [&](unsigned, std::size_t task) {
+      auto const other = task / 2;
+      if (other == t)
+        return;
+      if (task % 2 == 0) {
+        auto* const c = tile(d, stride, t, other);
+        kernels.close(c, diagonal, c, stride);
+      } else {
+        auto* const c = tile(d, stride, other, t);
+        kernels.close(c, c, diagonal, stride);
+      }
+    });
+
+    for_each_stealing(pool, tiles * tiles, [&](unsigned, std::size_t task) {
+      auto const i = task / tiles, j = task % tiles;
+      if (i == t || j == t)
+        return;
+      kernels.multiply(tile(d, stride, i, j), tile(d, stride, i, t),
+                       tile(d, stride, t, j), stride);
+    });
+  }
+}
+
+std::size_t min_plus_squaring(ThreadPool& pool, std::int32_t* d, std::size_t n,
+                              std::size_t stride, MinPlusKernels const& kernels) {
+  // With 0 on the diagonal, min(d, d * d) is d * d: the product starts from
+  // a copy of d.
+  auto const size = n * stride;
+  auto square = std::vector<std::int32_t>(size);
+  std::size_t products = 0;
+  for (std::size_t edges = 1; edges + 1 < n; edges *= 2) {
+    std::memcpy(square.data(), d, size * sizeof(*d));
+    min_plus_product(pool, square.data(), d, d, n, stride, kernels);
+    ++products;
+    if (std::memcmp(square.data(), d, size * sizeof(*d)) == 0)
+      break;
+    std::memcpy(d, square.data(), size * sizeof(*d));
+  }
+  return products;
+}
+
+}  // namespace simd
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "simd.hxx"
+
+namespace simd {
+
+class ThreadPool;
+
+// (min,+) matrix products over int32 distances: c[i][j] = min over k of
+// a[i][k] + b[k][j], the product under which shortest paths compose.
+// INT32_MAX is infinity, "no path": anything added to it stays infinity,
+// and finite sums saturate at INT32_MAX and INT32_MIN instead of wrapping.
+constexpr std::int32_t min_plus_inf = std::numeric_limits<std::int32_t>::max();
+
+// The side of the square tiles the kernels work on.  A tile row is four
+// AVX-512 or eight AVX2 registers, and three tiles fit in L2.
+constexpr std::size_t min_plus_tile = 64;
+
+// Kernels over one tile of each matrix, rows `stride` elements apart.
+struct MinPlusKernels {
+  // c = min(c, a * b).  c must not overlap a or b; each row of c stays in
+  // registers while k runs over the tile.
+  void (*multiply)(std::int32_t* c, std::int32_t const* a,
+                   std::int32_t const* b, std::size_t stride);
+  // The same with k outermost, which is correct where c is also a or b:
+  // Floyd-Warshall's update of a diagonal tile, its row and its column.
+  void (*close)(std::int32_t* c, std::int32_t const* a,
+                std::int32_t const* b, std::size_t stride);
+};
+
+// Kernels for `isa`, or nullptr when !isa_supported(isa).
+MinPlusKernels const* min_plus_kernels(Isa isa) noexcept;
+
+// Kernels for best_isa().
+MinPlusKernels const& min_plus_kernels() noexcept;
+
+// Whole matrices of n x n distances, rows `stride` elements apart, tile by
+// tile over pool's workers.  n and stride must be multiples of
+// min_plus_tile: pad the rows and columns past the last vertex with
+// infinity, and their diagonal with 0.
+
+// c = min(c, a * b), where c overlaps neither a nor b.
+void min_plus_product(ThreadPool& pool, std::int32_t* c, std::int32_t const* a,
+                      std::int32_t const* b, std::size_t n, std::size_t stride,
+                      MinPlusKernels const& kernels = min_plus_kernels());
+
+// All-pairs shortest paths in place, from d holding the edge weights and 0
+// on the diagonal: blocked Floyd-Warshall, the diagonal tile of each k
+// first, then its row and column, then every other tile in parallel.  A
+// negative cycle leaves a negative distance on the diagonal.
+void min_plus_closure(ThreadPool& pool, std::int32_t* d, std::size_t n,
+                      std::size_t stride,
+                      MinPlusKernels const& kernels = min_plus_kernels());
+
+// The same by repeated squaring, d = d * d, until the paths of up to n - 1
+// edges are covered or a product changes nothing.  O(n^3 log n) against
+// Floyd-Warshall's O(n^3), but every product is independent tiles.
+// Returns the number of products.
+std::size_t min_plus_squaring(ThreadPool& pool, std::int32_t* d, std::size_t n,
+                              std::size_t stride,
+                              MinPlusKernels const& kernels = min_plus_kernels());
+
+}  // namespace simd
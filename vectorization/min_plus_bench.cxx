@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "min_plus.hxx"
+#include "perf_counters.hxx"
+#include "simd.hxx"
+#include "thread_pool.hxx"
+
+namespace {
+
+using simd::min_plus_inf;
+
+// n x n distances of a random graph, about `degree` edges per vertex, with
+// 0 on the diagonal.  Weights are reduced costs w + p[u] - p[v], some of
+// them negative, so that no cycle is.
+std::vector<std::int32_t> random_graph(std::size_t n, std::size_t degree) {
+  std::mt19937 random(42);
+  std::uniform_int_distribution<std::int32_t> potential(0, 50), weight(0, 100);
+  std::bernoulli_distribution edge(static_cast<double>(degree) / static_cast<double>(n));
+  std::vector<std::int32_t> p(n);
+  for (auto& x : p)
+    x = potential(random);
+
+  std::vector<std::int32_t> d(n * n, min_plus_inf);
+  for (std::size_t u = 0; u < n; ++u) {
+    for (std::size_t v = 0; v < n; ++v) {
+      if (u == v)
+        d[u * n + v] = 0;
+      else if (edge(random))
+        d[u * n + v] = weight(random) + p[u] - p[v];
+    }
+  }
+  return d;
+}
+
+}  // namespace
+
+// The textbook loops, kept scalar, as every (min,+) kernel starts out.
+#if defined(__GNUC__) && !defined(__clang__)
+# pragma GCC push_options
+# pragma GCC optimize ("O2,no-tree-vectorize")
+#endif
+static void triple_loop_product(std::int32_t* c, std::int32_t const* a,
+                                std::int32_t const* b, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      auto best = c[i * n + j];
+      for (std::size_t k = 0; k < n; ++k) {
+        auto const aik = a[i * n + k], bkj = b[k * n + j];
+        if (aik != min_plus_inf && bkj != min_plus_inf)
+          best = std::min(best, aik + bkj);
+      }
+      c[i * n + j] = best;
+    }
+  }
+}
+
+static void triple_loop_closure(std::int32_t* d, std::size_t n) {
+  for (std::size_t k = 0; k < n; ++k) {
+    for (std::size_t i = 0; i < n; ++i) {
+      auto const dik = d[i * n + k];
+      if (dik == min_plus_inf)
+        continue;
+      for (std::size_t j = 0; j < n; ++j) {
+        auto const dkj = d[k * n + j];
+        if (dkj != min_plus_inf)
+          d[i * n + j] = std::min(d[i * n + j], dik + dkj);
+      }
+    }
+  }
+}
+#if defined(__GNUC__) && !defined(__clang__)
+# pragma GCC pop_options
+#endif
+
+// range(0) is the number of vertices; items are (min,+) steps, n^3 per
+// product or closure, so every variant reports the same unit.  Products
+// are of a complete graph, which leaves no row of b to skip; closures are
+// of a sparse one, as the paths filled in make it dense.  The kernels run
+// on a pool's worker, hence real time.
+static void Product_TripleLoop(benchmark::State& state) {
+  auto const n = static_cast<std::size_t>(state.range(0));
+  auto const a = random_graph(n, n);
+  auto c = a;
+
+  perf::BenchmarkCounters counters(state);
+  for (auto _ : state) {
+    triple_loop_product(c.data(), a.data(), a.data(), n);
+
+    benchmark::DoNotOptimize(c.data());
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * n * n * n);
+}
+
+// On one worker, to compare the kernels alone.
+template <simd::Isa I>
+static void Product(benchmark::State& state) {
+  auto const* kernels = simd::min_plus_kernels(I);
+  if (!kernels) {
+    state.SkipWithError("ISA not supported on this host");
+    for (auto _ : state) {}
+    return;
+  }
+
+  auto const n = static_cast<std::size_t>(state.range(0));
+  auto const a = random_graph(n, n);
+  auto c = a;
+  simd::ThreadPool pool(1);
+
+  perf::BenchmarkCounters counters(state);
+  for (auto _ : state) {
+    simd::min_plus_product(pool, c.data(), a.data(), a.data(), n, n, *kernels);
+
+    benchmark::DoNotOptimize(c.data());
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * n * n * n);
+}
+
+static void Closure_TripleLoop(benchmark::State& state) {
+  auto const n = static_cast<std::size_t>(state.range(0));
+  auto const graph = random_graph(n, 8);
+  auto d = graph;
+
+  perf::BenchmarkCounters counters(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+    d = graph;
+    state.ResumeTiming();
+    triple_loop_closure(d.data(), n);
+
+    benchmark::DoNotOptimize(d.data());
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * n * n * n);
+}
+
+template <simd::Isa I>
+static void Closure(benchmark::State& state) {
+  auto const* kernels = simd::min_plus_kernels(I);
+  if (!kernels) {
+    state.SkipWithError("ISA not supported on this host");
+    for (auto _ : state) {}
+    return;
+  }
+
+  auto const n = static_cast<std::size_t>(state.range(0));
+  auto const graph = random_graph(n, 8);
+  auto d = graph;
+  simd::ThreadPool pool(1);
+
+  perf::BenchmarkCounters counters(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+    d = graph;
+    state.ResumeTiming();
+    simd::min_plus_closure(pool, d.data(), n, n, *kernels);
+
+    benchmark::DoNotOptimize(d.data());
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * n * n * n);
+}
+
+// All-pairs by squaring with the best kernels; items still count one n^3,
+// so the rate shows what the extra log n products cost against Closure.
+static void Squaring(benchmark::State& state) {
+  auto const n = static_cast<std::size_t>(state.range(0));
+  auto const graph = random_graph(n, 8);
+  auto d = graph;
+  simd::ThreadPool pool(1);
+
+  std::size_t products = 0;
+  perf::BenchmarkCounters counters(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+    d = graph;
+    state.ResumeTiming();
+    products = simd::min_plus_squaring(pool, d.data(), n, n);
+
+    benchmark::DoNotOptimize(d.data());
+    benchmark::ClobberMemory();
+  }
+
+  state.counters["products"] = static_cast<double>(products);
+  state.SetItemsProcessed(state.iterations() * n * n * n);
+}
+
+// The best kernels' closure over a pool of range(1) workers.
+static void ParallelClosure(benchmark::State& state) {
+  auto const n = static_cast<std::size_t>(state.range(0));
+  auto const graph = random_graph(n, 8);
+  auto d = graph;
+  simd::ThreadPool pool(static_cast<unsigned>(state.range(1)));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    d = graph;
+    state.ResumeTiming();
+    simd::min_plus_closure(pool, d.data(), n, n);
+
+    benchmark::DoNotOptimize(d.data());
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * n * n * n);
+}
+static void ParallelClosureArgs(benchmark::internal::Benchmark* b) {
+  auto const max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  for (unsigned n = 1;; n = std::min(n * 2, max_threads)) {
+    b->Args({1024, n});
+    if (n == max_threads)
+      break;
+  }
+}
+
+#define MIN_PLUS_BENCHMARK(name)                                         \
+  BENCHMARK(name##_TripleLoop)->RangeMultiplier(2)->Range(256, 1024);   \
+  BENCHMARK_TEMPLATE(name, simd::Isa::Scalar)                           \
+  ->RangeMultiplier(2)->Range(256, 1024)->UseRealTime();                \
+  BENCHMARK_TEMPLATE(name, simd::Isa::SSE42)                            \
+  ->RangeMultiplier(2)->Range(256, 1024)->UseRealTime();                \
+  BENCHMARK_TEMPLATE(name, simd::Isa::AVX2)                             \
+  ->RangeMultiplier(2)->Range(256, 1024)->UseRealTime();                \
+  BENCHMARK_TEMPLATE(name, simd::Isa::AVX512)                           \
+  ->RangeMultiplier(2)->Range(256, 1024)->UseRealTime()
+
+MIN_PLUS_BENCHMARK(Product);
+MIN_PLUS_BENCHMARK(Closure);
+
+BENCHMARK(Squaring)->RangeMultiplier(2)->Range(256, 1024)->UseRealTime();
+
+BENCHMARK(ParallelClosure)
+->ArgNames({"n", "threads"})
+->Apply(ParallelClosureArgs)
+->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,87 @@
+#pragma once
+
+// Internal to the simd library.
+//
+// The (min,+) tile kernels, over the Vec<std::int32_t> of an ISA unit:
+// loadu(), storeu(), set1(), min() and adds_inf().  Like simd_detail.hxx,
+// include this header after the unit's SIMD_TARGET_PUSH().
+
+#include <cstddef>
+#include <cstdint>
+
+#include "min_plus.hxx"
+#include "simd_detail.hxx"
+
+namespace simd::detail {
+
+extern MinPlusKernels const scalar_min_plus_kernels;
+#if defined(SIMD_BUILD_SSE42)
+extern MinPlusKernels const sse42_min_plus_kernels;
+#endif
+#if defined(SIMD_BUILD_AVX2)
+extern MinPlusKernels const avx2_min_plus_kernels;
+#endif
+#if defined(SIMD_BUILD_AVX512)
+extern MinPlusKernels const avx512_min_plus_kernels;
+#endif
+
+namespace {
+
+// An a[i][k] of infinity can lower nothing, so its row of b is skipped
+// before it is loaded.
+template <typename V>
+void min_plus_multiply(std::int32_t* c, std::int32_t const* a,
+                       std::int32_t const* b, std::size_t stride) {
+  constexpr auto regs = min_plus_tile / V::lanes;
+  for (std::size_t i = 0; i < min_plus_tile; ++i) {
+    auto* const ci = c + i * stride;
+    typename V::reg row[regs];
+    SIMD_UNROLL(16)
+    for (std::size_t r = 0; r < regs; ++r)
+      row[r] = V::loadu(ci + r * V::lanes);
+    for (std::size_t k = 0; k < min_plus_tile; ++k) {
+      auto const aik = a[i * stride + k];
+      if (aik == min_plus_inf)
+        continue;
+      auto const va = V::set1(aik);
+      auto const* const bk = b + k * stride;
+      SIMD_UNROLL(16)
+      for (std::size_t r = 0; r < regs; ++r)
+        row[r] = V::min(row[r], V::adds_inf(va, V::loadu(bk + r * V::lanes)));
+    }
+    SIMD_UNROLL(16)
+    for (std::size_t r = 0; r < regs; ++r)
+      V::storeu(ci + r * V::lanes, row[r]);
+  }
+}
+
+template <typename V>
+void min_plus_close(std::int32_t* c, std::int32_t const* a,
+                    std::int32_t const* b, std::size_t stride) {
+  constexpr auto regs = min_plus_tile / V::lanes;
+  for (std::size_t k = 0; k < min_plus_tile; ++k) {
+    auto const* const bk = b + k * stride;
+    for (std::size_t i = 0; i < min_plus_tile; ++i) {
+      auto const aik = a[i * stride + k];
+      if (aik == min_plus_inf)
+        continue;
+      auto const va = V::set1(aik);
+      auto* const ci = c + i * stride;
+      SIMD_UNROLL(16)
+      for (std::size_t r = 0; r < regs; ++r) {
+        V::storeu(ci + r * V::lanes,
+                  V::min(V::loadu(ci + r * V::lanes),
+                         V::adds_inf(va, V::loadu(bk + r * V::lanes))));
+      }
+    }
+  }
+}
+
+template <typename V>
+constexpr MinPlusKernels make_min_plus_kernels() noexcept {
+  return {min_plus_multiply<V>, min_plus_close<V>};
+}
+
+}  // namespace
+
+}  // namespace simd::detail
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "simd.hxx"
+#include "thread_pool.hxx"
+
+namespace simd {
+
+// Start of band `band` when `n` bytes are split into `nbands` bands.  Bands
+// start on cache lines, and on pages once every band spans at least one, so
+// no two workers share a line and first-touch placement is exact.  The
+// split only depends on (n, nbands): every job over the same buffer and pool
+// gives a worker the same band.
+inline std::size_t band_begin(std::size_t n, unsigned band,
+                              unsigned nbands) noexcept {
+  std::size_t const align = n / nbands >= 4096 ? 4096 : 64;
+  std::size_t const units = (n + align - 1) / align;
+  std::size_t const begin = units * band / nbands * align;
+  return begin < n ? begin : n;
+}
+
+// Calls fn(begin, end) for each worker's band of [0, n).
+template <typename Fn>
+void for_each_band(ThreadPool& pool, std::size_t n, Fn&& fn) {
+  auto const nbands = pool.size();
+  pool.run([&](unsigned band) {
+    auto const begin = band_begin(n, band, nbands);
+    auto const end = band_begin(n, band + 1, nbands);
+    if (begin < end)
+      fn(begin, end);
+  });
+}
+
+// Zeroes a fresh buffer from the workers that will process it, so on a NUMA
+// host each band's pages are allocated on the node of its worker.  The
+// buffer must not have been written yet (operator new, not make_unique).
+inline void first_touch(ThreadPool& pool, void* p, std::size_t n) {
+  auto* bytes = static_cast<std::uint8_t*>(p);
+  for_each_band(pool, n, [&](std::size_t begin, std::size_t end) {
+    std::memset(bytes + begin, 0, end - begin);
+  });
+}
+
+// Runs one ByteKernels entry over the pool, e.g.
+// parallel(pool, simd::kernels().add_k, dst, src, n, 42).  Store::Auto is
+// resolved against the whole buffer, not against each band.
+inline void parallel(ThreadPool& pool,
+                     void (*kernel)(std::uint8_t*, std::uint8_t const*,
+                                    std::uint8_t const*, std::size_t, Store),
+                     std::uint8_t* dst, std::uint8_t const* a,
+                     std::uint8_t const* b, std::size_t n,
+                     Store store = Store::Auto) {
+  store = resolve_store(store, n, dst == a || dst == b);
+  for_each_band(pool, n, [&](std::size_t begin, std::size_t end) {
+    kernel(dst + begin, a + begin, b + begin, end - begin, store);
+  });
+}
+
+inline void parallel(ThreadPool& pool,
+                     void (*kernel)(std::uint8_t*, std::uint8_t const*,
+                                    std::size_t, std::uint8_t, Store),
+                     std::uint8_t* dst, std::uint8_t const* src,
+                     std::size_t n, std::uint8_t k,
+                     Store store = Store::Auto) {
+  store = resolve_store(store, n, dst == src);
+  for_each_band(pool, n, [&](std::size_t begin, std::size_t end) {
+    kernel(dst + begin, src + begin, end - begin, k, store);
+  });
+}
+
+}  // namespace simd
@@ -0,0 +1,185 @@
+#pragma once
+
+// Hardware performance counters for the benchmarks, via perf_event_open(2).
+//
+//   static void Foo(benchmark::State& state) {
+//     ...setup...
+//     perf::BenchmarkCounters counters(state);
+//     for (auto _ : state) { ... }
+//   }
+//
+// adds cycles, instructions, ipc, l1d_misses, llc_misses and branch_misses
+// per iteration to the benchmark's user counters (and so to its JSON
+// output).  Counting is per thread: work handed to other threads, e.g. a
+// ThreadPool, is not included.  Where the kernel refuses an event (no PMU
+// in a VM, perf_event_paranoid, a seccomp filter, not Linux) that counter is
+// simply left out.
+//
+// Header-only, so that the Makefile-built benchmarks can use it too.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+namespace perf {
+
+struct Event {
+  char const* name;
+  std::uint32_t type;
+  std::uint64_t config;
+};
+
+inline std::vector<Event> default_events() {
+#if defined(__linux__)
+  constexpr std::uint64_t l1d_read_miss =
+      PERF_COUNT_HW_CACHE_L1D |
+      PERF_COUNT_HW_CACHE_OP_READ << 8 |
+      PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+  return {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"l1d_misses", PERF_TYPE_HW_CACHE, l1d_read_miss},
+    // The generic cache-misses event counts last-level cache misses.
+    {"llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+  };
+#else
+  return {};
+#endif
+}
+
+// One counter per event for the calling thread, user space only.  The
+// events are opened independently rather than as a group, so a PMU with
+// fewer counters than events multiplexes them; read() scales each count by
+// the fraction of time its event was actually scheduled.
+class Counters {
+public:
+  explicit Counters(std::vector<Event> const& events = default_events()) {
+#if defined(__linux__)
+    for (auto const& event : events) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = event.type;
+      attr.config = event.config;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format =
+          PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      auto const fd = static_cast<int>(
+          syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+      if (fd >= 0)
+        open_.push_back({event.name, fd});
+    }
+#else
+    (void)events;
+#endif
+  }
+
+  ~Counters() {
+#if defined(__linux__)
+    for (auto const& counter : open_)
+      close(counter.fd);
+#endif
+  }
+
+  Counters(Counters const&) = delete;
+  Counters& operator = (Counters const&) = delete;
+
+  // False when the kernel accepted none of the events.
+  bool available() const noexcept { return !open_.empty(); }
+
+  void start() noexcept {
+#if defined(__linux__)
+    for (auto const& counter : open_) {
+      ioctl(counter.fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(counter.fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  void stop() noexcept {
+#if defined(__linux__)
+    for (auto const& counter : open_)
+      ioctl(counter.fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+  }
+
+  // (name, count) for every open event.
+  std::vector<std::pair<char const*, double>> read() const {
+    std::vector<std::pair<char const*, double>> counts;
+#if defined(__linux__)
+    for (auto const& counter : open_) {
+      std::uint64_t value[3] = {};  // count, time enabled, time running
+      if (::read(counter.fd, value, sizeof(value)) != sizeof(value))
+        continue;
+      auto count = static_cast<double>(value[0]);
+      if (value[2] != 0 && value[2] < value[1])
+        count *= static_cast<double>(value[1]) / static_cast<double>(value[2]);
+      else if (value[2] == 0)
+        count = 0;
+      counts.emplace_back(counter.name, count);
+    }
+#endif
+    return counts;
+  }
+
+private:
+  struct Open {
+    char const* name;
+    int fd;
+  };
+  std::vector<Open> open_;
+};
+
+// Counts from construction to destruction, around a benchmark's loop, and
+// stores per-iteration averages in state.counters.  Templated on the state
+// type so that this header does not depend on Google Benchmark.
+template <typename State>
+class BenchmarkCounters {
+public:
+  explicit BenchmarkCounters(State& state,
+                             std::vector<Event> const& events = default_events())
+    : state_(state)
+    , counters_(events) {
+    counters_.start();
+  }
+
+  ~BenchmarkCounters() {
+    counters_.stop();
+    if (state_.iterations() == 0)
+      return;
+
+    using Counter = typename decltype(state_.counters)::mapped_type;
+    double cycles = 0;
+    double instructions = 0;
+    for (auto const& [name, count] : counters_.read()) {
+      state_.counters[name] = Counter(count, Counter::kAvgIterations);
+      if (std::strcmp(name, "cycles") == 0)
+        cycles = count;
+      else if (std::strcmp(name, "instructions") == 0)
+        instructions = count;
+    }
+    if (cycles > 0 && instructions > 0)
+      state_.counters["ipc"] = Counter(instructions / cycles);
+  }
+
+  BenchmarkCounters(BenchmarkCounters const&) = delete;
+  BenchmarkCounters& operator = (BenchmarkCounters const&) = delete;
+
+private:
+  State& state_;
+  Counters counters_;
+};
+
+}  // namespace perf
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "cpuid.hxx"
+#include "min_plus.hxx"
+#include "simd.hxx"
+
+#if defined(__GNUC__) && !defined(__clang__)
+# pragma GCC push_options
+# pragma GCC optimize ("O2,tree-vectorize")
+#endif
+
+#include "min_plus_detail.hxx"
+#include "simd_detail.hxx"
+
+namespace simd {
+
+namespace detail {
+
+namespace {
+
+std::uint8_t saturating_add(std::uint8_t a, std::uint8_t b) {
+  return std::min(unsigned(a) + b, 0xffu);
+}
+std::uint16_t saturating_add(std::uint16_t a, std::uint16_t b) {
+  return std::min(unsigned(a) + b, 0xffffu);
+}
+std::int32_t saturating_add(std::int32_t a, std::int32_t b) {
+  using limits = std::numeric_limits<std::int32_t>;
+  return std::clamp<std::int64_t>(std::int64_t{a} + b, limits::min(),
+                                  limits::max());
+}
+float saturating_add(float a, float b) { return a + b; }
+double saturating_add(double a, double b) { return a + b; }
+
+// INT32_MAX is infinity in (min,+) products: nothing added to it brings
+// it back.
+std::int32_t saturating_add_inf(std::int32_t a, std::int32_t b) {
+  using limits = std::numeric_limits<std::int32_t>;
+  if (a == limits::max() || b == limits::max())
+    return limits::max();
+  return saturating_add(a, b);
+}
+
+// Integer products wrap like the vector mullo instructions; the arithmetic
+// is done unsigned so that wrapping is defined.
+std::uint16_t multiply_add(std::uint16_t a, std::uint16_t x, std::uint16_t b) {
+  return static_cast<std::uint16_t>(unsigned(a) * x + b);
+}
+std::int32_t multiply_add(std::int32_t a, std::int32_t x, std::int32_t b) {
+  return static_cast<std::int32_t>(std::uint32_t(a) * std::uint32_t(x) +
+                                   std::uint32_t(b));
+}
+float multiply_add(float a, float x, float b) { return a * x + b; }
+double multiply_add(double a, double x, double b) { return a * x + b; }
+
+// One element per "register": the loops reduce to plain element-wise code
+// that the compiler is free to auto-vectorise for the baseline target.
+template <typename T>
+struct Vec {
+  using elem = T;
+  using reg = T;
+  static constexpr std::size_t lanes = 1;
+
+  static reg loadu(void const* p) { return *static_cast<reg const*>(p); }
+  static void storeu(void* p, reg v) { *static_cast<reg*>(p) = v; }
+  static void stream(void* p, reg v) { storeu(p, v); }
+  static void fence() {}
+  static void prefetch(void const*) {}
+  static reg set1(T k) { return k; }
+
+  static reg add(reg a, reg b) { return a + b; }
+  static reg sub(reg a, reg b) { return a - b; }
+  static reg adds(reg a, reg b) { return saturating_add(a, b); }
+  static reg adds_inf(reg a, reg b) { return saturating_add_inf(a, b); }
+  static reg fma(reg a, reg x, reg b) { return multiply_add(a, x, b); }
+  static reg min(reg a, reg b) { return std::min(a, b); }
+  static reg max(reg a, reg b) { return std::max(a, b); }
+  static reg gt(reg a, reg b) { return a > b ? 0xff : 0; }
+};
+
+}  // namespace
+
+ByteKernels const scalar_byte_kernels = make_byte_kernels<Vec<std::uint8_t>>();
+WideKernels const scalar_wide_kernels = make_wide_kernels<Vec>();
+MinPlusKernels const scalar_min_plus_kernels =
+    make_min_plus_kernels<Vec<std::int32_t>>();
+
+}  // namespace detail
+
+#if defined(__GNUC__) && !defined(__clang__)
+# pragma GCC pop_options
+#endif
+
+char const* isa_name(Isa isa) noexcept {
+  switch (isa) {
+  case Isa::Scalar: return "scalar";
+  case Isa::SSE42:  return "sse4.2";
+  case Isa::AVX2:   return "avx2";
+  case Isa::AVX512: return "avx512";
+  }
+  return "unknown";
+}
+
+namespace {
+
+std::size_t default_streaming_threshold() noexcept {
+  auto const llc = cpu_features().llc_size();
+  return llc ? llc / 2 : std::size_t{8} << 20;
+}
+
+// A function-local static, so kernels called from other static initialisers
+// never see it zero.
+std::atomic<std::size_t>& streaming_threshold_() noexcept {
+  static std::atomic<std::size_t> bytes{default_streaming_threshold()};
+  return bytes;
+}
+
+}  // namespace
+
+std::size_t streaming_threshold() noexcept {
+  return streaming_threshold_().load(std::memory_order_relaxed);
+}
+
+void set_streaming_threshold(std::size_t bytes) noexcept {
+  streaming_threshold_().store(bytes, std::memory_order_relaxed);
+}
+
+bool isa_supported(Isa isa) noexcept {
+  return kernels(isa) != nullptr;
+}
+
+ByteKernels const* kernels(Isa isa) noexcept {
+  switch (isa) {
+  case Isa::Scalar:
+    return &detail::scalar_byte_kernels;
+  case Isa::SSE42:
+#if defined(SIMD_BUILD_SSE42)
+    if (has_sse42())
+      return &detail::sse42_byte_kernels;
+#endif
+    return nullptr;
+  case Isa::AVX2:
+#if defined(SIMD_BUILD_AVX2)
+    // The AVX2 unit is compiled with FMA as well.
+    if (has_avx2() && cpu_features().fma)
+      return &detail::avx2_byte_kernels;
+#endif
+    return nullptr;
+  case Isa::AVX512:
+#if defined(SIMD_BUILD_AVX512)
+    if (has_avx512())
+      return &detail::avx512_byte_kernels;
+#endif
+    return nullptr;
+  }
+  return nullptr;
+}
+
+WideKernels const* wide_kernels(Isa isa) noexcept {
+  if (!isa_supported(isa))
+    return nullptr;
+  switch (isa) {
+  case Isa::Scalar:
+    return &detail::scalar_wide_kernels;
+#if defined(SIMD_BUILD_SSE42)
+  case Isa::SSE42:
+    return &detail::sse42_wide_kernels;
+#endif
+#if defined(SIMD_BUILD_AVX2)
+  case Isa::AVX2:
+    return &detail::avx2_wide_kernels;
+#endif
+#if defined(SIMD_BUILD_AVX512)
+  case Isa::AVX512:
+    return &detail::avx512_wide_kernels;
+#endif
+  default:
+    return nullptr;
+  }
+}
+
+Isa best_isa() noexcept {
+  static Isa const best = [] {
+    for (auto isa : {Isa::AVX512, Isa::AVX2, Isa::SSE42}) {
+      if (isa_supported(isa))
+        return isa;
+    }
+    return Isa::Scalar;
+  }();
+  return best;
+}
+
+ByteKernels const& kernels() noexcept {
+  static ByteKernels const& best = *kernels(best_isa());
+  return best;
+}
+
+WideKernels const& wide_kernels() noexcept {
+  static WideKernels const& best = *wide_kernels(best_isa());
+  return best;
+}
+
+}  // namespace simd
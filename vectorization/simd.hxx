@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace simd {
+
+enum class Isa {
+  Scalar,
+  SSE42,
+  AVX2,
+  AVX512,
+};
+
+char const* isa_name(Isa isa) noexcept;
+
+// True when the kernels for `isa` are compiled in and the host can run them.
+bool isa_supported(Isa isa) noexcept;
+
+// The widest supported ISA, detected once on first use.
+Isa best_isa() noexcept;
+
+enum class Store {
+  // Streaming once the destination exceeds streaming_threshold(), unless the
+  // operation is in place: the loads have just cached the destination lines,
+  // and streaming them out again only costs an extra eviction.
+  Auto,
+  // Regular stores; the result stays in cache for the next pass.
+  Cached,
+  // Non-temporal stores that bypass the cache, with prefetched loads, for
+  // buffers that will not be read again before they are evicted anyway.
+  Streaming,
+};
+
+// Destination size in bytes above which Store::Auto streams.  Defaults to
+// half the detected last-level cache, leaving room for the sources.
+std::size_t streaming_threshold() noexcept;
+void set_streaming_threshold(std::size_t bytes) noexcept;
+
+inline Store resolve_store(Store store, std::size_t bytes,
+                           bool in_place) noexcept {
+  if (store != Store::Auto)
+    return store;
+  if (in_place)
+    return Store::Cached;
+  return bytes > streaming_threshold() ? Store::Streaming : Store::Cached;
+}
+
+// Byte-matrix kernels for one instruction set.  A matrix is a dense buffer of
+// `n` bytes; `dst` may alias any of the sources.
+struct ByteKernels {
+  // dst[i] = a[i] op b[i]
+  void (*add)(std::uint8_t* dst, std::uint8_t const* a, std::uint8_t const* b,
+              std::size_t n, Store store);
+  void (*sub)(std::uint8_t* dst, std::uint8_t const* a, std::uint8_t const* b,
+              std::size_t n, Store store);
+  void (*adds)(std::uint8_t* dst, std::uint8_t const* a, std::uint8_t const* b,
+               std::size_t n, Store store);
+  void (*min)(std::uint8_t* dst, std::uint8_t const* a, std::uint8_t const* b,
+              std::size_t n, Store store);
+  void (*max)(std::uint8_t* dst, std::uint8_t const* a, std::uint8_t const* b,
+              std::size_t n, Store store);
+
+  // dst[i] = src[i] op k
+  void (*add_k)(std::uint8_t* dst, std::uint8_t const* src, std::size_t n,
+                std::uint8_t k, Store store);
+  void (*sub_k)(std::uint8_t* dst, std::uint8_t const* src, std::size_t n,
+                std::uint8_t k, Store store);
+  void (*adds_k)(std::uint8_t* dst, std::uint8_t const* src, std::size_t n,
+                 std::uint8_t k, Store store);
+  void (*min_k)(std::uint8_t* dst, std::uint8_t const* src, std::size_t n,
+                std::uint8_t k, Store store);
+  void (*max_k)(std::uint8_t* dst, std::uint8_t const* src, std::size_t n,
+                std::uint8_t k, Store store);
+
+  // dst[i] = src[i] > k ? 0xff : 0
+  void (*threshold)(std::uint8_t* dst, std::uint8_t const* src, std::size_t n,
+                    std::uint8_t k, Store store);
+};
+
+// Kernels for one wider element type.  The scalar tables are the
+// auto-vectorised fallbacks; floating point results may differ from them in
+// the last bit where the vector tables fuse a*x+b and the fallback does not.
+template <typename T>
+struct ElementKernels {
+  // dst[i] = src[i] + k, saturating for integers
+  void (*adds_k)(T* dst, T const* src, std::size_t n, T k, Store store);
+  // dst[i] = a * src[i] + b, wrapping for integers
+  void (*fma)(T* dst, T const* src, std::size_t n, T a, T b, Store store);
+  // dst[i] = min(max(src[i], lo), hi)
+  void (*clamp)(T* dst, T const* src, std::size_t n, T lo, T hi,
+                Store store);
+};
+
+struct WideKernels {
+  ElementKernels<std::uint16_t> u16;
+  ElementKernels<std::int32_t> i32;
+  ElementKernels<float> f32;
+  ElementKernels<double> f64;
+};
+
+// Kernels for `isa`, or nullptr when !isa_supported(isa).
+ByteKernels const* kernels(Isa isa) noexcept;
+WideKernels const* wide_kernels(Isa isa) noexcept;
+
+// Kernels for best_isa().
+ByteKernels const& kernels() noexcept;
+WideKernels const& wide_kernels() noexcept;
+
+template <typename T>
+ElementKernels<T> const& element_kernels(WideKernels const& wide) noexcept {
+  if constexpr (std::is_same_v<T, std::uint16_t>)
+    return wide.u16;
+  else if constexpr (std::is_same_v<T, std::int32_t>)
+    return wide.i32;
+  else if constexpr (std::is_same_v<T, float>)
+    return wide.f32;
+  else if constexpr (std::is_same_v<T, double>)
+    return wide.f64;
+  else
+    static_assert(sizeof(T) == 0, "no kernels for this element type");
+}
+
+template <typename T>
+ElementKernels<T> const* element_kernels(Isa isa) noexcept {
+  auto const* wide = wide_kernels(isa);
+  return wide ? &element_kernels<T>(*wide) : nullptr;
+}
+
+template <typename T>
+ElementKernels<T> const& element_kernels() noexcept {
+  return element_kernels<T>(wide_kernels());
+}
+
+inline void add(std::uint8_t* dst, std::uint8_t const* a,
+                std::uint8_t const* b, std::size_t n,
+                Store store = Store::Auto) {
+  kernels().add(dst, a, b, n, store);
+}
+inline void sub(std::uint8_t* dst, std::uint8_t const* a,
+                std::uint8_t const* b, std::size_t n,
+                Store store = Store::Auto) {
+  kernels().sub(dst, a, b, n, store);
+}
+inline void adds(std::uint8_t* dst, std::uint8_t const* a,
+                 std::uint8_t const* b, std::size_t n,
+                 Store store = Store::Auto) {
+  kernels().adds(dst, a, b, n, store);
+}
+inline void min(std::uint8_t* dst, std::uint8_t const* a,
+                std::uint8_t const* b, std::size_t n,
+                Store store = Store::Auto) {
+  kernels().min(dst, a, b, n, store);
+}
+inline void max(std::uint8_t* dst, std::uint8_t const* a,
+                std::uint8_t const* b, std::size_t n,
+                Store store = Store::Auto) {
+  kernels().max(dst, a, b, n, store);
+}
+
+inline void add(std::uint8_t* dst, std::uint8_t const* src, std::size_t n,
+                std::uint8_t k, Store store = Store::Auto) {
+  kernels().add_k(dst, src, n, k, store);
+}
+inline void sub(std::uint8_t* dst, std::uint8_t const* src, std::size_t n,
+                std::uint8_t k, Store store = Store::Auto) {
+  kernels().sub_k(dst, src, n, k, store);
+}
+inline void adds(std::uint8_t* dst, std::uint8_t const* src, std::size_t n,
+                 std::uint8_t k, Store store = Store::Auto) {
+  kernels().adds_k(dst, src, n, k, store);
+}
+inline void min(std::uint8_t* dst, std::uint8_t const* src, std::size_t n,
+                std::uint8_t k, Store store = Store::Auto) {
+  kernels().min_k(dst, src, n, k, store);
+}
+inline void max(std::uint8_t* dst, std::uint8_t const* src, std::size_t n,
+                std::uint8_t k, Store store = Store::Auto) {
+  kernels().max_k(dst, src, n, k, store);
+}
+inline void threshold(std::uint8_t* dst, std::uint8_t const* src,
+                      std::size_t n, std::uint8_t k,
+                      Store store = Store::Auto) {
+  kernels().threshold(dst, src, n, k, store);
+}
+
+template <typename T>
+void adds(T* dst, T const* src, std::size_t n, std::type_identity_t<T> k,
+          Store store = Store::Auto) {
+  element_kernels<T>().adds_k(dst, src, n, k, store);
+}
+template <typename T>
+void fma(T* dst, T const* src, std::size_t n, std::type_identity_t<T> a,
+         std::type_identity_t<T> b, Store store = Store::Auto) {
+  element_kernels<T>().fma(dst, src, n, a, b, store);
+}
+template <typename T>
+void clamp(T* dst, T const* src, std::size_t n, std::type_identity_t<T> lo,
+           std::type_identity_t<T> hi, Store store = Store::Auto) {
+  element_kernels<T>().clamp(dst, src, n, lo, hi, store);
+}
+
+}  // namespace simd
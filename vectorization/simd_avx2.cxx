@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <immintrin.h>
+
+#include "frame.hxx"
+#include "min_plus.hxx"
+#include "simd.hxx"
+#include "target.hxx"
+
+SIMD_TARGET_PUSH("avx2,fma")
+
+#include "frame_detail.hxx"
+#include "min_plus_detail.hxx"
+#include "simd_detail.hxx"
+
+#if defined(SIMD_BUILD_AVX2)
+namespace simd::detail {
+
+namespace {
+
+template <typename T>
+struct Vec;
+
+struct IntRegs {
+  using reg = __m256i;
+
+  static reg loadu(void const* p) {
+    return _mm256_loadu_si256(static_cast<__m256i const*>(p));
+  }
+  static void storeu(void* p, reg v) {
+    _mm256_storeu_si256(static_cast<__m256i*>(p), v);
+  }
+  // p must be register aligned.
+  static void stream(void* p, reg v) {
+    _mm256_stream_si256(static_cast<__m256i*>(p), v);
+  }
+  static void fence() { _mm_sfence(); }
+  static void prefetch(void const* p) {
+    _mm_prefetch(static_cast<char const*>(p), _MM_HINT_T0);
+  }
+};
+
+template <>
+struct Vec<std::uint8_t> : IntRegs {
+  using elem = std::uint8_t;
+  static constexpr std::size_t lanes = 32;
+
+  static reg set1(std::uint8_t k) {
+    return _mm256_set1_epi8(static_cast<char>(k));
+  }
+
+  static reg add(reg a, reg b) { return _mm256_add_epi8(a, b); }
+  static reg sub(reg a, reg b) { return _mm256_sub_epi8(a, b); }
+  static reg adds(reg a, reg b) { return _mm256_adds_epu8(a, b); }
+  static reg min(reg a, reg b) { return _mm256_min_epu8(a, b); }
+  static reg max(reg a, reg b) { return _mm256_max_epu8(a, b); }
+  // There is no unsigned byte compare before AVX-512; flip the sign bits.
+  static reg gt(reg a, reg b) {
+    auto const bias = _mm256_set1_epi8(static_cast<char>(0x80));
+    return _mm256_cmpgt_epi8(_mm256_xor_si256(a, bias),
+                             _mm256_xor_si256(b, bias));
+  }
+};
+
+template <>
+struct Vec<std::uint16_t> : IntRegs {
+  using elem = std::uint16_t;
+  static constexpr std::size_t lanes = 16;
+
+  static reg set1(std::uint16_t k) {
+    return _mm256_set1_epi16(static_cast<short>(k));
+  }
+
+  static reg adds(reg a, reg b) { return _mm256_adds_epu16(a, b); }
+  static reg fma(reg a, reg x, reg b) {
+    return _mm256_add_epi16(_mm256_mullo_epi16(a, x), b);
+  }
+  static reg min(reg a, reg b) { return _mm256_min_epu16(a, b); }
+  static reg max(reg a, reg b) { return _mm256_max_epu16(a, b); }
+};
+
+template <>
+struct Vec<std::int32_t> : IntRegs {
+  using elem = std::int32_t;
+  static constexpr std::size_t lanes = 8;
+
+  static reg set1(std::int32_t k) { return _mm256_set1_epi32(k); }
+
+  // Same overflow test as the SSE4.2 kernel, one register wider.
+  static reg adds(reg a, reg b) {
+    auto const sum = _mm256_add_epi32(a, b);
+    auto const overflow = _mm256_and_si256(_mm256_xor_si256(sum, a),
+                                           _mm256_xor_si256(sum, b));
+    auto const saturated = _mm256_xor_si256(_mm256_srai_epi32(a, 31),
+                                            _mm256_set1_epi32(INT32_MAX));
+    return _mm256_blendv_epi8(sum, saturated, _mm256_srai_epi32(overflow, 31));
+  }
+  static reg adds_inf(reg a, reg b) {
+    auto const inf = _mm256_set1_epi32(INT32_MAX);
+    auto const either = _mm256_or_si256(_mm256_cmpeq_epi32(a, inf),
+                                        _mm256_cmpeq_epi32(b, inf));
+    return _mm256_blendv_epi8(adds(a, b), inf, either);
+  }
+  static reg fma(reg a, reg x, reg b) {
+    return _mm256_add_epi32(_mm256_mullo_epi32(a, x), b);
+  }
+  static reg min(reg a, reg b) { return _mm256_min_epi32(a, b); }
+  static reg max(reg a, reg b) { return _mm256_max_epi32(a, b); }
+};
+
+template <>
+struct Vec<float> {
+  using elem = float;
+  using reg = __m256;
+  static constexpr std::size_t lanes = 8;
+
+  static reg loadu(void const* p) {
+    return _mm256_loadu_ps(static_cast<float const*>(p));
+  }
+  static void storeu(void* p, reg v) {
+    _mm256_storeu_ps(static_cast<float*>(p), v);
+  }
+  static void stream(void* p, reg v) {
+    _mm256_stream_ps(static_cast<float*>(p), v);
+  }
+  static void fence() { _mm_sfence(); }
+  static void prefetch(void const* p) {
+    _mm_prefetch(static_cast<char const*>(p), _MM_HINT_T0);
+  }
+  static reg set1(float k) { return _mm256_set1_ps(k); }
+
+  static reg adds(reg a, reg b) { return _mm256_add_ps(a, b); }
+  static reg fma(reg a, reg x, reg b) { return _mm256_fmadd_ps(a, x, b); }
+  static reg min(reg a, reg b) { return _mm256_min_ps(a, b); }
+  static reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+};
+
+template <>
+struct Vec<double> {
+  using elem = double;
+  using reg = __m256d;
+  static constexpr std::size_t lanes = 4;
+
+  static reg loadu(void const* p) {
+    return _mm256_loadu_pd(static_cast<double const*>(p));
+  }
+  static void storeu(void* p, reg v) {
+    _mm256_storeu_pd(static_cast<double*>(p), v);
+  }
+  static void stream(void* p, reg v) {
+    _mm256_stream_pd(static_cast<double*>(p), v);
+  }
+  static void fence() { _mm_sfence(); }
+  static void prefetch(void const* p) {
+    _mm_prefetch(static_cast<char const*>(p), _MM_HINT_T0);
+  }
+  static reg set1(double k) { return _mm256_set1_pd(k); }
+
+  static reg adds(reg a, reg b) { return _mm256_add_pd(a, b); }
+  static reg fma(reg a, reg x, reg b) { return _mm256_fmadd_pd(a, x, b); }
+  static reg min(reg a, reg b) { return _mm256_min_pd(a, b); }
+  static reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+};
+
+// Transpose: two side-by-side 16x16 blocks per register, one per lane.
+// Convolution: 16 pixels per register.  The in-lane unpacks and packs undo
+// each other, so only the final byte pack needs a cross-lane permute.
+struct Frame {
+  using reg = __m256i;
+  static constexpr std::size_t blocks = 2;
+
+  static reg loadu(void const* p) {
+    return _mm256_loadu_si256(static_cast<__m256i const*>(p));
+  }
+  static reg unpacklo8(reg a, reg b) { return _mm256_unpacklo_epi8(a, b); }
+  static reg unpackhi8(reg a, reg b) { return _mm256_unpackhi_epi8(a, b); }
+  static reg unpacklo16(reg a, reg b) { return _mm256_unpacklo_epi16(a, b); }
+  static reg unpackhi16(reg a, reg b) { return _mm256_unpackhi_epi16(a, b); }
+  static reg unpacklo32(reg a, reg b) { return _mm256_unpacklo_epi32(a, b); }
+  static reg unpackhi32(reg a, reg b) { return _mm256_unpackhi_epi32(a, b); }
+  static reg unpacklo64(reg a, reg b) { return _mm256_unpacklo_epi64(a, b); }
+  static reg unpackhi64(reg a, reg b) { return _mm256_unpackhi_epi64(a, b); }
+  static void store_blocks(std::uint8_t* p, std::size_t block_stride, reg v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p),
+                     _mm256_castsi256_si128(v));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + block_stride),
+                     _mm256_extracti128_si256(v, 1));
+  }
+
+  using wide = __m256i;
+  struct acc { __m256i lo, hi; };
+  static constexpr std::size_t wlanes = 16;
+
+  static wide widen(std::uint8_t const* p) {
+    return _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<__m128i const*>(p)));
+  }
+  static wide loadw(std::int16_t const* p) {
+    return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+  }
+  static void storew(std::int16_t* p, wide v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+  }
+  static wide setw(std::int16_t k) { return _mm256_set1_epi16(k); }
+  static wide mulw(wide a, wide b) { return _mm256_mullo_epi16(a, b); }
+  static wide addw(wide a, wide b) { return _mm256_add_epi16(a, b); }
+
+  static acc acc_init(std::int32_t round) {
+    return {_mm256_set1_epi32(round), _mm256_set1_epi32(round)};
+  }
+  using pair = __m256i;
+  static pair make_pair(std::int16_t ka, std::int16_t kb) {
+    return _mm256_set1_epi32(static_cast<std::uint16_t>(ka) |
+                         static_cast<std::uint32_t>(kb) << 16);
+  }
+  static acc mac2(acc sum, wide a, wide b, pair k) {
+    return {
+      _mm256_add_epi32(sum.lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), k)),
+      _mm256_add_epi32(sum.hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), k)),
+    };
+  }
+  static void narrow(std::uint8_t* p, acc sum, unsigned shift) {
+    auto const count = _mm_cvtsi32_si128(static_cast<int>(shift));
+    auto const w = _mm256_packs_epi32(_mm256_sra_epi32(sum.lo, count),
+                                      _mm256_sra_epi32(sum.hi, count));
+    auto const b = _mm256_permute4x64_epi64(_mm256_packus_epi16(w, w), 0x08);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(b));
+  }
+};
+
+}  // namespace
+
+ByteKernels const avx2_byte_kernels = make_byte_kernels<Vec<std::uint8_t>>();
+WideKernels const avx2_wide_kernels = make_wide_kernels<Vec>();
+FrameKernels const avx2_frame_kernels = make_frame_kernels<Frame>();
+MinPlusKernels const avx2_min_plus_kernels =
+    make_min_plus_kernels<Vec<std::int32_t>>();
+
+}  // namespace simd::detail
+#endif  // defined(SIMD_BUILD_AVX2)
+
+SIMD_TARGET_POP()
@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// GCC 12 reports the self-initialised placeholder registers inside its own
+// AVX-512 intrinsics as (maybe-)uninitialised (GCC PR 105593).
+#if defined(__GNUC__) && !defined(__clang__)
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wuninitialized"
+# pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__clang__)
+# pragma GCC diagnostic pop
+#endif
+
+#include "frame.hxx"
+#include "min_plus.hxx"
+#include "simd.hxx"
+#include "target.hxx"
+
+SIMD_TARGET_PUSH("avx512f,avx512bw")
+
+#include "frame_detail.hxx"
+#include "min_plus_detail.hxx"
+#include "simd_detail.hxx"
+
+#if defined(SIMD_BUILD_AVX512)
+namespace simd::detail {
+
+namespace {
+
+template <typename T>
+struct Vec;
+
+struct IntRegs {
+  using reg = __m512i;
+
+  static reg loadu(void const* p) {
+    return _mm512_loadu_si512(static_cast<__m512i const*>(p));
+  }
+  static void storeu(void* p, reg v) {
+    _mm512_storeu_si512(static_cast<__m512i*>(p), v);
+  }
+  // p must be register aligned.
+  static void stream(void* p, reg v) {
+    _mm512_stream_si512(static_cast<__m512i*>(p), v);
+  }
+  static void fence() { _mm_sfence(); }
+  static void prefetch(void const* p) {
+    _mm_prefetch(static_cast<char const*>(p), _MM_HINT_T0);
+  }
+};
+
+template <>
+struct Vec<std::uint8_t> : IntRegs {
+  using elem = std::uint8_t;
+  static constexpr std::size_t lanes = 64;
+
+  static reg set1(std::uint8_t k) {
+    return _mm512_set1_epi8(static_cast<char>(k));
+  }
+
+  static reg add(reg a, reg b) { return _mm512_add_epi8(a, b); }
+  static reg sub(reg a, reg b) { return _mm512_sub_epi8(a, b); }
+  static reg adds(reg a, reg b) { return _mm512_adds_epu8(a, b); }
+  static reg min(reg a, reg b) { return _mm512_min_epu8(a, b); }
+  static reg max(reg a, reg b) { return _mm512_max_epu8(a, b); }
+  static reg gt(reg a, reg b) {
+    return _mm512_movm_epi8(_mm512_cmpgt_epu8_mask(a, b));
+  }
+};
+
+template <>
+struct Vec<std::uint16_t> : IntRegs {
+  using elem = std::uint16_t;
+  static constexpr std::size_t lanes = 32;
+
+  static reg set1(std::uint16_t k) {
+    return _mm512_set1_epi16(static_cast<short>(k));
+  }
+
+  static reg adds(reg a, reg b) { return _mm512_adds_epu16(a, b); }
+  static reg fma(reg a, reg x, reg b) {
+    return _mm512_add_epi16(_mm512_mullo_epi16(a, x), b);
+  }
+  static reg min(reg a, reg b) { return _mm512_min_epu16(a, b); }
+  static reg max(reg a, reg b) { return _mm512_max_epu16(a, b); }
+};
+
+template <>
+struct Vec<std::int32_t> : IntRegs {
+  using elem = std::int32_t;
+  static constexpr std::size_t lanes = 16;
+
+  static reg set1(std::int32_t k) { return _mm512_set1_epi32(k); }
+
+  // The overflow test as a mask: negative lanes of (sum^a) & (sum^b).
+  static reg adds(reg a, reg b) {
+    auto const sum = _mm512_add_epi32(a, b);
+    auto const overflow = _mm512_cmplt_epi32_mask(
+        _mm512_and_si512(_mm512_xor_si512(sum, a), _mm512_xor_si512(sum, b)),
+        _mm512_setzero_si512());
+    auto const saturated = _mm512_xor_si512(_mm512_srai_epi32(a, 31),
+                                            _mm512_set1_epi32(INT32_MAX));
+    return _mm512_mask_blend_epi32(overflow, sum, saturated);
+  }
+  static reg adds_inf(reg a, reg b) {
+    auto const inf = _mm512_set1_epi32(INT32_MAX);
+    auto const either = _mm512_cmpeq_epi32_mask(a, inf) | _mm512_cmpeq_epi32_mask(b, inf);
+    return _mm512_mask_mov_epi32(adds(a, b), either, inf);
+  }
+  static reg fma(reg a, reg x, reg b) {
+    return _mm512_add_epi32(_mm512_mullo_epi32(a, x), b);
+  }
+  static reg min(reg a, reg b) { return _mm512_min_epi32(a, b); }
+  static reg max(reg a, reg b) { return _mm512_max_epi32(a, b); }
+};
+
+template <>
+struct Vec<float> {
+  using elem = float;
+  using reg = __m512;
+  static constexpr std::size_t lanes = 16;
+
+  static reg loadu(void const* p) {
+    return _mm512_loadu_ps(static_cast<float const*>(p));
+  }
+  static void storeu(void* p, reg v) {
+    _mm512_storeu_ps(static_cast<float*>(p), v);
+  }
+  static void stream(void* p, reg v) {
+    _mm512_stream_ps(static_cast<float*>(p), v);
+  }
+  static void fence() { _mm_sfence(); }
+  static void prefetch(void const* p) {
+    _mm_prefetch(static_cast<char const*>(p), _MM_HINT_T0);
+  }
+  static reg set1(float k) { return _mm512_set1_ps(k); }
+
+  static reg adds(reg a, reg b) { return _mm512_add_ps(a, b); }
+  static reg fma(reg a, reg x, reg b) { return _mm512_fmadd_ps(a, x, b); }
+  static reg min(reg a, reg b) { return _mm512_min_ps(a, b); }
+  static reg max(reg a, reg b) { return _mm512_max_ps(a, b); }
+};
+
+template <>
+struct Vec<double> {
+  using elem = double;
+  using reg = __m512d;
+  static constexpr std::size_t lanes = 8;
+
+  static reg loadu(void const* p) {
+    return _mm512_loadu_pd(static_cast<double const*>(p));
+  }
+  static void storeu(void* p, reg v) {
+    _mm512_storeu_pd(static_cast<double*>(p), v);
+  }
+  static void stream(void* p, reg v) {
+    _mm512_stream_pd(static_cast<double*>(p), v);
+  }
+  static void fence() { _mm_sfence(); }
+  static void prefetch(void const* p) {
+    _mm_prefetch(static_cast<char const*>(p), _MM_HINT_T0);
+  }
+  static reg set1(double k) { return _mm512_set1_pd(k); }
+
+  static reg adds(reg a, reg b) { return _mm512_add_pd(a, b); }
+  static reg fma(reg a, reg x, reg b) { return _mm512_fmadd_pd(a, x, b); }
+  static reg min(reg a, reg b) { return _mm512_min_pd(a, b); }
+  static reg max(reg a, reg b) { return _mm512_max_pd(a, b); }
+};
+
+// Transpose: four side-by-side 16x16 blocks per register.  Convolution: 32
+// pixels per register, narrowed with vpmovuswb after clearing negatives.
+struct Frame {
+  using reg = __m512i;
+  static constexpr std::size_t blocks = 4;
+
+  static reg loadu(void const* p) { return _mm512_loadu_si512(p); }
+  static reg unpacklo8(reg a, reg b) { return _mm512_unpacklo_epi8(a, b); }
+  static reg unpackhi8(reg a, reg b) { return _mm512_unpackhi_epi8(a, b); }
+  static reg unpacklo16(reg a, reg b) { return _mm512_unpacklo_epi16(a, b); }
+  static reg unpackhi16(reg a, reg b) { return _mm512_unpackhi_epi16(a, b); }
+  static reg unpacklo32(reg a, reg b) { return _mm512_unpacklo_epi32(a, b); }
+  static reg unpackhi32(reg a, reg b) { return _mm512_unpackhi_epi32(a, b); }
+  static reg unpacklo64(reg a, reg b) { return _mm512_unpacklo_epi64(a, b); }
+  static reg unpackhi64(reg a, reg b) { return _mm512_unpackhi_epi64(a, b); }
+  static void store_blocks(std::uint8_t* p, std::size_t block_stride, reg v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p),
+                     _mm512_extracti32x4_epi32(v, 0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + block_stride),
+                     _mm512_extracti32x4_epi32(v, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 2 * block_stride),
+                     _mm512_extracti32x4_epi32(v, 2));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 3 * block_stride),
+                     _mm512_extracti32x4_epi32(v, 3));
+  }
+
+  using wide = __m512i;
+  struct acc { __m512i lo, hi; };
+  static constexpr std::size_t wlanes = 32;
+
+  static wide widen(std::uint8_t const* p) {
+    return _mm512_cvtepu8_epi16(
+        _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p)));
+  }
+  static wide loadw(std::int16_t const* p) { return _mm512_loadu_si512(p); }
+  static void storew(std::int16_t* p, wide v) { _mm512_storeu_si512(p, v); }
+  static wide setw(std::int16_t k) { return _mm512_set1_epi16(k); }
+  static wide mulw(wide a, wide b) { return _mm512_mullo_epi16(a, b); }
+  static wide addw(wide a, wide b) { return _mm512_add_epi16(a, b); }
+
+  static acc acc_init(std::int32_t round) {
+    return {_mm512_set1_epi32(round), _mm512_set1_epi32(round)};
+  }
+  using pair = __m512i;
+  static pair make_pair(std::int16_t ka, std::int16_t kb) {
+    return _mm512_set1_epi32(static_cast<std::uint16_t>(ka) |
+                         static_cast<std::uint32_t>(kb) << 16);
+  }
+  static acc mac2(acc sum, wide a, wide b, pair k) {
+    return {
+      _mm512_add_epi32(sum.lo, _mm512_madd_epi16(_mm512_unpacklo_epi16(a, b), k)),
+      _mm512_add_epi32(sum.hi, _mm512_madd_epi16(_mm512_unpackhi_epi16(a, b), k)),
+    };
+  }
+  static void narrow(std::uint8_t* p, acc sum, unsigned shift) {
+    auto const count = _mm_cvtsi32_si128(static_cast<int>(shift));
+    auto const w = _mm512_packs_epi32(_mm512_sra_epi32(sum.lo, count),
+                                      _mm512_sra_epi32(sum.hi, count));
+    auto const b = _mm512_cvtusepi16_epi8(
+        _mm512_max_epi16(w, _mm512_setzero_si512()));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), b);
+  }
+};
+
+}  // namespace
+
+ByteKernels const avx512_byte_kernels = make_byte_kernels<Vec<std::uint8_t>>();
+WideKernels const avx512_wide_kernels = make_wide_kernels<Vec>();
+FrameKernels const avx512_frame_kernels = make_frame_kernels<Frame>();
+MinPlusKernels const avx512_min_plus_kernels =
+    make_min_plus_kernels<Vec<std::int32_t>>();
+
+}  // namespace simd::detail
+#endif  // defined(SIMD_BUILD_AVX512)
+
+SIMD_TARGET_POP()
@@ -0,0 +1,239 @@
+#pragma once
+
+// Internal to the simd library.
+//
+// Every ISA translation unit defines `Vec<T>` for each element type T (the
+// register type, lanes per register and the primitive operations) and
+// instantiates the loops below with it.
+// Include this header *after* the unit's SIMD_TARGET_PUSH() (target.hxx) so
+// the loop templates are compiled for that ISA; the standard headers must be
+// included before the push.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "simd.hxx"
+#include "target.hxx"
+
+// GCC compiles each ISA unit through SIMD_TARGET_PUSH() and MSVC exposes
+// every intrinsic unconditionally; other compilers only get the kernels the
+// global -march already enables.
+#if defined(_MSC_VER) || SIMD_HAS_TARGET
+# define SIMD_BUILD_SSE42 1
+# define SIMD_BUILD_AVX2 1
+# define SIMD_BUILD_AVX512 1
+#else
+# if defined(__SSE4_2__)
+#  define SIMD_BUILD_SSE42 1
+# endif
+# if defined(__AVX2__)
+#  define SIMD_BUILD_AVX2 1
+# endif
+# if defined(__AVX512F__) && defined(__AVX512BW__)
+#  define SIMD_BUILD_AVX512 1
+# endif
+#endif
+
+// Complete unrolling of the short fixed-count loops over register arrays,
+// which -O2 otherwise leaves rolled and spills to the stack.
+#if defined(__clang__)
+# define SIMD_UNROLL(n) _Pragma("unroll")
+#elif defined(__GNUC__)
+# define SIMD_UNROLL(n) SIMD_PRAGMA(GCC unroll n)
+#else
+# define SIMD_UNROLL(n)
+#endif
+
+namespace simd::detail {
+
+extern ByteKernels const scalar_byte_kernels;
+extern WideKernels const scalar_wide_kernels;
+#if defined(SIMD_BUILD_SSE42)
+extern ByteKernels const sse42_byte_kernels;
+extern WideKernels const sse42_wide_kernels;
+#endif
+#if defined(SIMD_BUILD_AVX2)
+extern ByteKernels const avx2_byte_kernels;
+extern WideKernels const avx2_wide_kernels;
+#endif
+#if defined(SIMD_BUILD_AVX512)
+extern ByteKernels const avx512_byte_kernels;
+extern WideKernels const avx512_wide_kernels;
+#endif
+
+namespace {
+
+template <typename V>
+using binary_op = typename V::reg (*)(typename V::reg, typename V::reg);
+
+// Streaming loops prefetch their sources this far ahead, in bytes.
+constexpr std::size_t prefetch_distance = 512;
+
+// Elements before `p` reaches a register boundary, capped at `n`.
+template <typename V>
+std::size_t head_elements(typename V::elem const* p, std::size_t n) noexcept {
+  constexpr auto reg_bytes = sizeof(typename V::reg);
+  auto const misalign = reinterpret_cast<std::uintptr_t>(p) % reg_bytes;
+  auto const head = misalign ? (reg_bytes - misalign) / sizeof(*p) : 0;
+  return head < n ? head : n;
+}
+
+// Non-temporal stores need a register-aligned destination, which a pointer
+// that is not even element aligned never reaches.
+template <typename V>
+bool can_stream(Store store, std::size_t n, bool in_place,
+                typename V::elem const* dst) noexcept {
+  return resolve_store(store, n * sizeof(*dst), in_place) ==
+             Store::Streaming &&
+         reinterpret_cast<std::uintptr_t>(dst) % alignof(decltype(*dst)) == 0;
+}
+
+// Fewer than V::lanes elements go through a zero-padded copy, so each
+// operation is written once, as a vector primitive.
+template <typename V, typename Op>
+void partial_unary(typename V::elem* dst, typename V::elem const* src,
+                   std::size_t n, Op const& op) {
+  using T = typename V::elem;
+  if (n == 0)
+    return;
+  alignas(64) T t[V::lanes] = {};
+  std::memcpy(t, src, n * sizeof(T));
+  V::storeu(t, op(V::loadu(t)));
+  std::memcpy(dst, t, n * sizeof(T));
+}
+
+template <typename V, typename Op>
+void partial_binary(typename V::elem* dst, typename V::elem const* a,
+                    typename V::elem const* b, std::size_t n, Op const& op) {
+  using T = typename V::elem;
+  if (n == 0)
+    return;
+  alignas(64) T ta[V::lanes] = {};
+  alignas(64) T tb[V::lanes] = {};
+  std::memcpy(ta, a, n * sizeof(T));
+  std::memcpy(tb, b, n * sizeof(T));
+  V::storeu(ta, op(V::loadu(ta), V::loadu(tb)));
+  std::memcpy(dst, ta, n * sizeof(T));
+}
+
+// dst[i] = op(src[i]) over whole registers.
+template <typename V, typename Op>
+void map_unary(typename V::elem* dst, typename V::elem const* src,
+               std::size_t n, Store store, Op const& op) {
+  std::size_t i = 0;
+  if (can_stream<V>(store, n, dst == src, dst)) {
+    i = head_elements<V>(dst, n);
+    partial_unary<V>(dst, src, i, op);
+    for (; i + V::lanes <= n; i += V::lanes) {
+      V::prefetch(reinterpret_cast<char const*>(src + i) + prefetch_distance);
+      V::stream(dst + i, op(V::loadu(src + i)));
+    }
+    V::fence();
+  } else {
+    for (; i + V::lanes <= n; i += V::lanes) {
+      V::storeu(dst + i, op(V::loadu(src + i)));
+    }
+  }
+  partial_unary<V>(dst + i, src + i, n - i, op);
+}
+
+// dst[i] = op(a[i], b[i]) over whole registers.
+template <typename V, typename Op>
+void map_binary(typename V::elem* dst, typename V::elem const* a,
+                typename V::elem const* b, std::size_t n, Store store,
+                Op const& op) {
+  std::size_t i = 0;
+  if (can_stream<V>(store, n, dst == a || dst == b, dst)) {
+    i = head_elements<V>(dst, n);
+    partial_binary<V>(dst, a, b, i, op);
+    for (; i + V::lanes <= n; i += V::lanes) {
+      V::prefetch(reinterpret_cast<char const*>(a + i) + prefetch_distance);
+      V::prefetch(reinterpret_cast<char const*>(b + i) + prefetch_distance);
+      V::stream(dst + i, op(V::loadu(a + i), V::loadu(b + i)));
+    }
+    V::fence();
+  } else {
+    for (; i + V::lanes <= n; i += V::lanes) {
+      V::storeu(dst + i, op(V::loadu(a + i), V::loadu(b + i)));
+    }
+  }
+  partial_binary<V>(dst + i, a + i, b + i, n - i, op);
+}
+
+template <typename V, binary_op<V> Op>
+void byte_binary(std::uint8_t* dst, std::uint8_t const* a,
+                 std::uint8_t const* b, std::size_t n, Store store) {
+  map_binary<V>(dst, a, b, n, store, Op);
+}
+
+template <typename V, binary_op<V> Op>
+void byte_constant(std::uint8_t* dst, std::uint8_t const* src, std::size_t n,
+                   std::uint8_t k, Store store) {
+  auto const vk = V::set1(k);
+  map_unary<V>(dst, src, n, store, [vk](typename V::reg x) {
+    return Op(x, vk);
+  });
+}
+
+template <typename V>
+constexpr ByteKernels make_byte_kernels() noexcept {
+  return {
+    byte_binary<V, V::add>,
+    byte_binary<V, V::sub>,
+    byte_binary<V, V::adds>,
+    byte_binary<V, V::min>,
+    byte_binary<V, V::max>,
+    byte_constant<V, V::add>,
+    byte_constant<V, V::sub>,
+    byte_constant<V, V::adds>,
+    byte_constant<V, V::min>,
+    byte_constant<V, V::max>,
+    byte_constant<V, V::gt>,
+  };
+}
+
+template <typename V, typename T = typename V::elem>
+void adds_k(T* dst, T const* src, std::size_t n, T k, Store store) {
+  auto const vk = V::set1(k);
+  map_unary<V>(dst, src, n, store, [vk](typename V::reg x) {
+    return V::adds(x, vk);
+  });
+}
+
+template <typename V, typename T = typename V::elem>
+void fma(T* dst, T const* src, std::size_t n, T a, T b, Store store) {
+  auto const va = V::set1(a);
+  auto const vb = V::set1(b);
+  map_unary<V>(dst, src, n, store, [va, vb](typename V::reg x) {
+    return V::fma(va, x, vb);
+  });
+}
+
+template <typename V, typename T = typename V::elem>
+void clamp(T* dst, T const* src, std::size_t n, T lo, T hi, Store store) {
+  auto const vlo = V::set1(lo);
+  auto const vhi = V::set1(hi);
+  map_unary<V>(dst, src, n, store, [vlo, vhi](typename V::reg x) {
+    return V::min(V::max(x, vlo), vhi);
+  });
+}
+
+template <typename V>
+constexpr ElementKernels<typename V::elem> make_element_kernels() noexcept {
+  return {adds_k<V>, fma<V>, clamp<V>};
+}
+
+template <template <typename> class Vec>
+constexpr WideKernels make_wide_kernels() noexcept {
+  return {
+    make_element_kernels<Vec<std::uint16_t>>(),
+    make_element_kernels<Vec<std::int32_t>>(),
+    make_element_kernels<Vec<float>>(),
+    make_element_kernels<Vec<double>>(),
+  };
+}
+
+}  // namespace
+
+}  // namespace simd::detail
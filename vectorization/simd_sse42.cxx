@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <immintrin.h>
+
+#include "frame.hxx"
+#include "min_plus.hxx"
+#include "simd.hxx"
+#include "target.hxx"
+
+SIMD_TARGET_PUSH("sse4.2")
+
+#include "frame_detail.hxx"
+#include "min_plus_detail.hxx"
+#include "simd_detail.hxx"
+
+#if defined(SIMD_BUILD_SSE42)
+namespace simd::detail {
+
+namespace {
+
+template <typename T>
+struct Vec;
+
+struct IntRegs {
+  using reg = __m128i;
+
+  static reg loadu(void const* p) {
+    return _mm_loadu_si128(static_cast<__m128i const*>(p));
+  }
+  static void storeu(void* p, reg v) {
+    _mm_storeu_si128(static_cast<__m128i*>(p), v);
+  }
+  // p must be register aligned.
+  static void stream(void* p, reg v) {
+    _mm_stream_si128(static_cast<__m128i*>(p), v);
+  }
+  static void fence() { _mm_sfence(); }
+  static void prefetch(void const* p) {
+    _mm_prefetch(static_cast<char const*>(p), _MM_HINT_T0);
+  }
+};
+
+template <>
+struct Vec<std::uint8_t> : IntRegs {
+  using elem = std::uint8_t;
+  static constexpr std::size_t lanes = 16;
+
+  static reg set1(std::uint8_t k) {
+    return _mm_set1_epi8(static_cast<char>(k));
+  }
+
+  static reg add(reg a, reg b) { return _mm_add_epi8(a, b); }
+  static reg sub(reg a, reg b) { return _mm_sub_epi8(a, b); }
+  static reg adds(reg a, reg b) { return _mm_adds_epu8(a, b); }
+  static reg min(reg a, reg b) { return _mm_min_epu8(a, b); }
+  static reg max(reg a, reg b) { return _mm_max_epu8(a, b); }
+  // There is no unsigned byte compare before AVX-512; flip the sign bits.
+  static reg gt(reg a, reg b) {
+    auto const bias = _mm_set1_epi8(static_cast<char>(0x80));
+    return _mm_cmpgt_epi8(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+  }
+};
+
+template <>
+struct Vec<std::uint16_t> : IntRegs {
+  using elem = std::uint16_t;
+  static constexpr std::size_t lanes = 8;
+
+  static reg set1(std::uint16_t k) {
+    return _mm_set1_epi16(static_cast<short>(k));
+  }
+
+  static reg adds(reg a, reg b) { return _mm_adds_epu16(a, b); }
+  static reg fma(reg a, reg x, reg b) {
+    return _mm_add_epi16(_mm_mullo_epi16(a, x), b);
+  }
+  static reg min(reg a, reg b) { return _mm_min_epu16(a, b); }
+  static reg max(reg a, reg b) { return _mm_max_epu16(a, b); }
+};
+
+template <>
+struct Vec<std::int32_t> : IntRegs {
+  using elem = std::int32_t;
+  static constexpr std::size_t lanes = 4;
+
+  static reg set1(std::int32_t k) { return _mm_set1_epi32(k); }
+
+  // The sum overflowed where its sign differs from both operands'; those
+  // lanes take INT32_MAX or INT32_MIN, following the sign of a.
+  static reg adds(reg a, reg b) {
+    auto const sum = _mm_add_epi32(a, b);
+    auto const overflow = _mm_and_si128(_mm_xor_si128(sum, a),
+                                        _mm_xor_si128(sum, b));
+    auto const saturated = _mm_xor_si128(_mm_srai_epi32(a, 31),
+                                         _mm_set1_epi32(INT32_MAX));
+    return _mm_blendv_epi8(sum, saturated, _mm_srai_epi32(overflow, 31));
+  }
+  // adds(), except that INT32_MAX in either operand gives INT32_MAX.
+  static reg adds_inf(reg a, reg b) {
+    auto const inf = _mm_set1_epi32(INT32_MAX);
+    auto const either = _mm_or_si128(_mm_cmpeq_epi32(a, inf), _mm_cmpeq_epi32(b, inf));
+    return _mm_blendv_epi8(adds(a, b), inf, either);
+  }
+  static reg fma(reg a, reg x, reg b) {
+    return _mm_add_epi32(_mm_mullo_epi32(a, x), b);
+  }
+  static reg min(reg a, reg b) { return _mm_min_epi32(a, b); }
+  static reg max(reg a, reg b) { return _mm_max_epi32(a, b); }
+};
+
+// No FMA at this level: a multiply and an add, rounded twice.
+template <>
+struct Vec<float> {
+  using elem = float;
+  using reg = __m128;
+  static constexpr std::size_t lanes = 4;
+
+  static reg loadu(void const* p) {
+    return _mm_loadu_ps(static_cast<float const*>(p));
+  }
+  static void storeu(void* p, reg v) {
+    _mm_storeu_ps(static_cast<float*>(p), v);
+  }
+  static void stream(void* p, reg v) {
+    _mm_stream_ps(static_cast<float*>(p), v);
+  }
+  static void fence() { _mm_sfence(); }
+  static void prefetch(void const* p) {
+    _mm_prefetch(static_cast<char const*>(p), _MM_HINT_T0);
+  }
+  static reg set1(float k) { return _mm_set1_ps(k); }
+
+  static reg adds(reg a, reg b) { return _mm_add_ps(a, b); }
+  static reg fma(reg a, reg x, reg b) {
+    return _mm_add_ps(_mm_mul_ps(a, x), b);
+  }
+  static reg min(reg a, reg b) { return _mm_min_ps(a, b); }
+  static reg max(reg a, reg b) { return _mm_max_ps(a, b); }
+};
+
+template <>
+struct Vec<double> {
+  using elem = double;
+  using reg = __m128d;
+  static constexpr std::size_t lanes = 2;
+
+  static reg loadu(void const* p) {
+    return _mm_loadu_pd(static_cast<double const*>(p));
+  }
+  static void storeu(void* p, reg v) {
+    _mm_storeu_pd(static_cast<double*>(p), v);
+  }
+  static void stream(void* p, reg v) {
+    _mm_stream_pd(static_cast<double*>(p), v);
+  }
+  static void fence() { _mm_sfence(); }
+  static void prefetch(void const* p) {
+    _mm_prefetch(static_cast<char const*>(p), _MM_HINT_T0);
+  }
+  static reg set1(double k) { return _mm_set1_pd(k); }
+
+  static reg adds(reg a, reg b) { return _mm_add_pd(a, b); }
+  static reg fma(reg a, reg x, reg b) {
+    return _mm_add_pd(_mm_mul_pd(a, x), b);
+  }
+  static reg min(reg a, reg b) { return _mm_min_pd(a, b); }
+  static reg max(reg a, reg b) { return _mm_max_pd(a, b); }
+};
+
+// Transpose: one 16x16 block per register.  Convolution: 8 pixels per
+// register, widened to 16 bits.
+struct Frame {
+  using reg = __m128i;
+  static constexpr std::size_t blocks = 1;
+
+  static reg loadu(void const* p) {
+    return _mm_loadu_si128(static_cast<__m128i const*>(p));
+  }
+  static reg unpacklo8(reg a, reg b) { return _mm_unpacklo_epi8(a, b); }
+  static reg unpackhi8(reg a, reg b) { return _mm_unpackhi_epi8(a, b); }
+  static reg unpacklo16(reg a, reg b) { return _mm_unpacklo_epi16(a, b); }
+  static reg unpackhi16(reg a, reg b) { return _mm_unpackhi_epi16(a, b); }
+  static reg unpacklo32(reg a, reg b) { return _mm_unpacklo_epi32(a, b); }
+  static reg unpackhi32(reg a, reg b) { return _mm_unpackhi_epi32(a, b); }
+  static reg unpacklo64(reg a, reg b) { return _mm_unpacklo_epi64(a, b); }
+  static reg unpackhi64(reg a, reg b) { return _mm_unpackhi_epi64(a, b); }
+  static void store_blocks(std::uint8_t* p, std::size_t, reg v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+  }
+
+  using wide = __m128i;
+  struct acc { __m128i lo, hi; };
+  static constexpr std::size_t wlanes = 8;
+
+  static wide widen(std::uint8_t const* p) {
+    return _mm_cvtepu8_epi16(
+        _mm_loadl_epi64(reinterpret_cast<__m128i const*>(p)));
+  }
+  static wide loadw(std::int16_t const* p) {
+    return _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+  }
+  static void storew(std::int16_t* p, wide v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+  }
+  static wide setw(std::int16_t k) { return _mm_set1_epi16(k); }
+  static wide mulw(wide a, wide b) { return _mm_mullo_epi16(a, b); }
+  static wide addw(wide a, wide b) { return _mm_add_epi16(a, b); }
+
+  static acc acc_init(std::int32_t round) {
+    return {_mm_set1_epi32(round), _mm_set1_epi32(round)};
+  }
+  using pair = __m128i;
+  static pair make_pair(std::int16_t ka, std::int16_t kb) {
+    return _mm_set1_epi32(static_cast<std::uint16_t>(ka) |
+                      static_cast<std::uint32_t>(kb) << 16);
+  }
+  // pmaddwd on (a, b) pairs against (ka, kb) pairs.
+  static acc mac2(acc sum, wide a, wide b, pair k) {
+    return {
+      _mm_add_epi32(sum.lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), k)),
+      _mm_add_epi32(sum.hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), k)),
+    };
+  }
+  static void narrow(std::uint8_t* p, acc sum, unsigned shift) {
+    auto const count = _mm_cvtsi32_si128(static_cast<int>(shift));
+    auto const w = _mm_packs_epi32(_mm_sra_epi32(sum.lo, count),
+                                   _mm_sra_epi32(sum.hi, count));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packus_epi16(w, w));
+  }
+};
+
+}  // namespace
+
+ByteKernels const sse42_byte_kernels = make_byte_kernels<Vec<std::uint8_t>>();
+WideKernels const sse42_wide_kernels = make_wide_kernels<Vec>();
+FrameKernels const sse42_frame_kernels = make_frame_kernels<Frame>();
+MinPlusKernels const sse42_min_plus_kernels =
+    make_min_plus_kernels<Vec<std::int32_t>>();
+
+}  // namespace simd::detail
+#endif  // defined(SIMD_BUILD_SSE42)
+
+SIMD_TARGET_POP()
@@ -1,27 +1,34 @@
-#include <memory>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
 
 #include <benchmark/benchmark.h>
 #include <emmintrin.h>
 #include <immintrin.h>
 #include <mmintrin.h>
 
-#include "cpuid.hxx"
+#include "arena.hxx"
+#include "frame.hxx"
+#include "parallel.hxx"
+#include "perf_counters.hxx"
+#include "simd.hxx"
+#include "target.hxx"
+#include "thread_pool.hxx"
 
 // Good clear numbers:
 // http://quick-bench.com/fve5Wt5DvuB8PQRZ7JT-xAG2_H0
 
-auto  rows = 1080;
-auto  cols = 1280;
-
-struct aligned_deleter {
-  std::align_val_t align;
-  void operator()(std::uint8_t* p) const { operator delete[](p, align); }
-};
-
-auto aligned_unique_ptr(std::size_t size, std::align_val_t align) {
-  auto* p = operator new[](sizeof(std::uint8_t) * size, align);
-  return std::unique_ptr<std::uint8_t, aligned_deleter>(
-      reinterpret_cast<std::uint8_t*>(p), aligned_deleter{align});
+// Every benchmark resets this arena and carves its buffers from it, so the
+// pages are faulted once, by the largest benchmark to need them, and reused
+// warm (and huge where the kernel allows) by all the others.
+simd::Arena& arena() {
+  static simd::Arena arena(std::size_t{4} << 30);
+  return arena;
 }
 
 #if defined (_MSC_VER)
@@ -30,581 +37,519 @@ auto aligned_unique_ptr(std::size_t size, std::align_val_t align) {
 # define assume_aligned(ptr, x) ptr = reinterpret_cast<decltype(ptr)>(__builtin_assume_aligned(ptr, x));
 #endif
 
+// Every kernel below adds a constant to each of the n elements at ptr, which
+// is aligned to exactly Align bytes.
+
 #if defined(__GNUC__) && !defined(__clang__)
 # pragma GCC push_options
-# pragma GCC optimize ("O2,tree-vectorize")
-# pragma GCC target ("tune=native")
+# pragma GCC optimize ("O2,no-tree-vectorize")
 #endif
-static void AutoVec(benchmark::State& state) {
-  auto const ncells = rows * cols;
-
-  auto  pmat = std::make_unique<std::uint8_t[]>(rows * cols);
-  auto* mat = pmat.get();
+struct NoVec {
+  static bool supported() { return true; }
 
-  {
-    auto* ptr = mat;
-    for (int i = 0; i < ncells; ++i) {
-      *(ptr++) = 0;
+  template <std::size_t Align, typename T>
+  static void add(T* ptr, std::size_t n, T k) {
+    assume_aligned(ptr, Align);
+    for (std::size_t i = 0; i < n; ++i) {
+      *(ptr++) += k;
     }
   }
-
-  for (auto _ : state) {
-    auto* ptr = mat;
-    for (int i = 0; i < ncells; ++i) {
-      *ptr += 42;
-      ++ptr;
-    }
-    
-    benchmark::DoNotOptimize(mat);
-    benchmark::ClobberMemory();
-  }
-}
+};
 #if defined(__GNUC__) && !defined(__clang__)
 # pragma GCC pop_options
 #endif
-BENCHMARK(AutoVec);
 
 #if defined(__GNUC__) && !defined(__clang__)
 # pragma GCC push_options
 # pragma GCC optimize ("O2,tree-vectorize")
-# pragma GCC target ("tune=native")
 #endif
-static void AutoVecAligned16(benchmark::State& state) {
-  auto const ncells = rows * cols;
-
-  auto  pmat = aligned_unique_ptr(rows * cols, std::align_val_t{16});
-  auto* mat  = pmat.get();
-  assume_aligned(mat, 16);
-  
-  {
-    auto* ptr = mat;
-    for (int i = 0; i < ncells; ++i) {
-      *(ptr++) = 0;
-    }
-  }
 
-  for (auto _ : state) {
-    auto* ptr = mat;
-    for (int i = 0; i < ncells; ++i) {
-      *(ptr++) += 42;
-    }
-    
-    benchmark::DoNotOptimize(mat);
-    benchmark::ClobberMemory();
+// The NoVec loop left to the auto-vectoriser, once per ISA level.  Each
+// specialisation's add() is compiled for baseline x86-64 plus exactly the
+// features simd::isa_supported() checks, whatever the global -march; an
+// x86-64-vN level would also allow BMI, MOVBE, AVX-512VL and others that
+// supported() does not check.  AutoVec<Scalar> gets the global -march,
+// and is the only one supported where SIMD_TARGET() does nothing.
+template <simd::Isa I>
+struct AutoVec;
+
+#define SIMPLE_MAT_AUTO_VEC(I, ...)                                        \
+  template <>                                                              \
+  struct AutoVec<I> {                                                      \
+    static bool supported() {                                              \
+      return I == simd::Isa::Scalar                                        \
+        || (SIMD_HAS_TARGET && simd::isa_supported(I));                    \
+    }                                                                      \
+                                                                           \
+    template <std::size_t Align, typename T>                               \
+    __VA_ARGS__ static void add(T* ptr, std::size_t n, T k) {              \
+      assume_aligned(ptr, Align);                                          \
+      for (std::size_t i = 0; i < n; ++i) {                                \
+        *(ptr++) += k;                                                     \
+      }                                                                    \
+    }                                                                      \
   }
-}
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC pop_options
-#endif
-BENCHMARK(AutoVecAligned16);
 
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC push_options
-# pragma GCC optimize ("O2,tree-vectorize")
-# pragma GCC target ("tune=native")
-#endif
-static void AutoVecAligned32(benchmark::State& state) {
-  auto const ncells = rows * cols;
-
-  auto  pmat = aligned_unique_ptr(rows * cols, std::align_val_t{32});
-  auto* mat  = pmat.get();
-  assume_aligned(mat, 32);
-  
-  {
-    auto* ptr = mat;
-    for (int i = 0; i < ncells; ++i) {
-      *(ptr++) = 0;
-    }
-  }
+SIMPLE_MAT_AUTO_VEC(simd::Isa::Scalar);
+SIMPLE_MAT_AUTO_VEC(simd::Isa::SSE42, SIMD_TARGET("arch=x86-64,sse4.2"));
+SIMPLE_MAT_AUTO_VEC(simd::Isa::AVX2, SIMD_TARGET("arch=x86-64,avx2,fma"));
+SIMPLE_MAT_AUTO_VEC(simd::Isa::AVX512, SIMD_TARGET("arch=x86-64,avx512f,avx512bw"));
 
-  for (auto _ : state) {
-    auto* ptr = mat;
-    for (int i = 0; i < ncells; ++i) {
-      *(ptr++) += 42;
-    }
-    
-    benchmark::DoNotOptimize(mat);
-    benchmark::ClobberMemory();
-  }
-}
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC pop_options
-#endif
-BENCHMARK(AutoVecAligned32);
+// The same loop cloned for every level behind an ifunc: the loader binds
+// add() to the best clone once, so it is called like any other function,
+// without the table lookup of the simd library's dispatch.
+struct Cloned {
+  static bool supported() { return true; }
 
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC push_options
-# pragma GCC optimize ("O2,tree-vectorize")
-# pragma GCC target("tune=native")
-#endif
-static void AutoVecAligned64(benchmark::State& state) {
-  auto const ncells = rows * cols;
-
-  auto pmat = aligned_unique_ptr(rows * cols, std::align_val_t{64});
-  auto* mat = pmat.get();
-  assume_aligned(mat, 64);
-  
-  {
-    auto* ptr = mat;
-    for (int i = 0; i < ncells; ++i) {
-      *(ptr++) = 0;
+  template <std::size_t Align, typename T>
+  SIMD_TARGET_CLONES static void add(T* ptr, std::size_t n, T k) {
+    assume_aligned(ptr, Align);
+    for (std::size_t i = 0; i < n; ++i) {
+      *(ptr++) += k;
     }
   }
+};
 
-  for (auto _ : state) {
-    auto* ptr = mat;
-    for (int i = 0; i < ncells; ++i) {
-      *(ptr++) += 42;
-    }
-    
-    benchmark::DoNotOptimize(mat);
-    benchmark::ClobberMemory();
-  }
-}
 #if defined(__GNUC__) && !defined(__clang__)
 # pragma GCC pop_options
 #endif
-BENCHMARK(AutoVecAligned64);
-
-#if !defined(__clang__)
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC push_options
-# pragma GCC optimize ("O2")
-# pragma GCC target ("sse,sse2,sse3,ssse3,sse4,popcnt,abm,mmx,avx,avx512f,avx512bw,tune=skylake-avx512")
-#endif
-static void ManualVecAVX512(benchmark::State& state) {
-  if (!has_avx512()) {
-    state.SkipWithError("No AVX512 support");
-    for (auto _ : state) {}
-    return;
-  }
 
-  auto  pmat = std::make_unique<std::uint8_t[]>(rows * cols);
-  auto* mat = pmat.get();
+#if !defined(_MSC_VER)
+struct ManualVecMMX {
+  static bool supported() { return true; }
 
-  __m512i zeros = _mm512_setzero_si512();
-  __m512i const42 = _mm512_set1_epi8(42);
+  template <std::size_t Align>
+  SIMD_TARGET("mmx")
+  static void add(std::uint8_t* ptr, std::size_t n, std::uint8_t k) {
+    __m64 const vk = _mm_set1_pi8(static_cast<char>(k));
 
-  constexpr int nlanes = 64;
-  auto const ncells = cols * rows;
+    constexpr std::size_t nlanes = 8;
 
-  {
-    int i = 0;
-    auto* ptr = mat;
-    for (; i <= ncells - nlanes; i += nlanes) {
-      _mm512_storeu_si512((__m512i*)ptr, zeros);
+    std::size_t i = 0;
+    for (; i + nlanes <= n; i += nlanes) {
+      auto vec = _m_from_int64(*(const std::uint64_t*)ptr);
+      vec = _mm_add_pi8(vec, vk);
+      *reinterpret_cast<std::uint64_t*>(ptr) = _m_to_int64(vec);
       ptr += nlanes;
     }
-    for (; i < ncells; ++i) {
-      *ptr = 0;
+    for (; i < n; ++i) {
+      *ptr += k;
       ++ptr;
     }
+
+    _mm_empty();
   }
+};
+#endif  // !defined(_MSC_VER)
 
-  for (auto _ : state) {
-    int i = 0;
-    auto* ptr = mat;
-    for (; i <= ncells - nlanes; i += nlanes) {
-      auto vec = _mm512_loadu_si512((const __m512i*)ptr);
-      vec = _mm512_add_epi8(vec, const42);
-      _mm512_storeu_si512((__m512i*)ptr, vec);
-      ptr += nlanes;
-    }
-    for (; i < ncells; ++i) {
-      *ptr += 42;
-      ++ptr;
-    }
+// The manual kernels are the ones shipped in the simd library.
+template <simd::Isa I>
+struct ManualVec {
+  static bool supported() { return simd::isa_supported(I); }
 
-    benchmark::DoNotOptimize(mat);
-    benchmark::ClobberMemory();
+  template <std::size_t Align>
+  static void add(std::uint8_t* ptr, std::size_t n, std::uint8_t k) {
+    simd::kernels(I)->add_k(ptr, ptr, n, k, simd::Store::Auto);
   }
-}
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC pop_options
-#endif
-BENCHMARK(ManualVecAVX512);
+};
 
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC push_options
-# pragma GCC optimize ("O2")
-# pragma GCC target ("sse,sse2,sse3,ssse3,sse4,popcnt,abm,mmx,avx,avx512f,avx512bw,tune=skylake-avx512")
-#endif
-static void ManualVecAVX512Aligned(benchmark::State& state) {
-  if (!has_avx512()) {
-    state.SkipWithError("No AVX512 support");
+// What callers of simd::add() get on this host.
+struct Dispatched {
+  static bool supported() { return true; }
+
+  template <std::size_t Align>
+  static void add(std::uint8_t* ptr, std::size_t n, std::uint8_t k) {
+    simd::add(ptr, ptr, n, k);
+  }
+};
+
+// range(0) is the buffer size in bytes, so one run shows where each kernel
+// falls out of L1, L2, L3 and into DRAM.  Bytes processed count both the load
+// and the store of every element.
+template <typename Kernel, std::size_t Align, typename T>
+static void Add(benchmark::State& state) {
+  if (!Kernel::supported()) {
+    state.SkipWithError("ISA not supported on this host");
     for (auto _ : state) {}
     return;
   }
 
-  auto pmat = aligned_unique_ptr(rows * cols, std::align_val_t{64});
-  auto* mat = pmat.get();
-  assume_aligned(mat, 64);
-
-  __m512i zeros = _mm512_setzero_si512();
-  __m512i const42 = _mm512_set1_epi8(42);
+  auto const nbytes = static_cast<std::size_t>(state.range(0));
+  auto const n = nbytes / sizeof(T);
 
-  constexpr int nlanes = 64;
-  auto const ncells = cols * rows;
-
-  {
-    int i = 0;
-    auto* ptr = mat;
-    for (; i <= ncells - nlanes; i += nlanes) {
-      _mm512_store_si512((__m512i*)ptr, zeros);
-      ptr += nlanes;
-    }
-    for (; i < ncells; ++i) {
-      *ptr = 0;
-      ++ptr;
-    }
-  }
+  // Offsetting a 64-byte aligned buffer by Align (mod 64) makes Align its
+  // exact alignment rather than a lower bound.
+  arena().reset();
+  auto* mat = reinterpret_cast<T*>(
+      arena().allocate<std::uint8_t>(nbytes + 64) + Align % 64);
+  std::fill_n(mat, n, T{});
 
+  perf::BenchmarkCounters counters(state);
   for (auto _ : state) {
-    int i = 0;
-    auto* ptr = mat;
-    for (; i <= ncells - nlanes; i += nlanes) {
-      auto vec = _mm512_load_si512((const __m512i*)ptr);
-      vec = _mm512_add_epi8(vec, const42);
-      _mm512_store_si512((__m512i*)ptr, vec);
-      ptr += nlanes;
-    }
-    for (; i < ncells; ++i) {
-      *ptr += 42;
-      ++ptr;
-    }
+    Kernel::template add<Align>(mat, n, T(42));
 
     benchmark::DoNotOptimize(mat);
     benchmark::ClobberMemory();
   }
-}
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC pop_options
-#endif
-BENCHMARK(ManualVecAVX512Aligned);
-#endif  // !defined(__clang__)
 
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC push_options
-# pragma GCC optimize ("O2")
-# pragma GCC target("sse,sse2,sse3,ssse3,sse4,popcnt,abm,mmx,avx,avx2,tune=skylake")
-#endif
-static void ManualVecAVX2(benchmark::State& state) {
-  __m256i zeros = _mm256_setzero_si256();
-  __m256i const42 = _mm256_set1_epi8(42);
+  state.SetBytesProcessed(state.iterations() * n * sizeof(T) * 2);
+}
 
-  auto  pmat = std::make_unique<std::uint8_t[]>(rows * cols);
-  auto* mat = pmat.get();
+#define SIMPLE_MAT_BENCHMARK(...)                \
+  BENCHMARK_TEMPLATE(Add, __VA_ARGS__)           \
+  ->RangeMultiplier(4)                           \
+  ->Ranges({{4 << 10, 1 << 30}})
+
+SIMPLE_MAT_BENCHMARK(NoVec, 1, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(NoVec, 64, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(NoVec, 64, std::uint16_t);
+SIMPLE_MAT_BENCHMARK(NoVec, 64, std::uint32_t);
+SIMPLE_MAT_BENCHMARK(NoVec, 64, float);
+
+SIMPLE_MAT_BENCHMARK(AutoVec<simd::Isa::Scalar>, 1, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(AutoVec<simd::Isa::Scalar>, 16, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(AutoVec<simd::Isa::Scalar>, 32, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(AutoVec<simd::Isa::Scalar>, 64, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(AutoVec<simd::Isa::Scalar>, 64, std::uint16_t);
+SIMPLE_MAT_BENCHMARK(AutoVec<simd::Isa::Scalar>, 64, std::uint32_t);
+SIMPLE_MAT_BENCHMARK(AutoVec<simd::Isa::Scalar>, 64, float);
+SIMPLE_MAT_BENCHMARK(AutoVec<simd::Isa::SSE42>, 64, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(AutoVec<simd::Isa::SSE42>, 64, float);
+SIMPLE_MAT_BENCHMARK(AutoVec<simd::Isa::AVX2>, 64, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(AutoVec<simd::Isa::AVX2>, 64, float);
+SIMPLE_MAT_BENCHMARK(AutoVec<simd::Isa::AVX512>, 64, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(AutoVec<simd::Isa::AVX512>, 64, float);
+
+SIMPLE_MAT_BENCHMARK(Cloned, 1, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(Cloned, 64, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(Cloned, 64, float);
 
-  constexpr int nlanes = 32;
-  auto const ncells = cols * rows;
+#if !defined(_MSC_VER)
+SIMPLE_MAT_BENCHMARK(ManualVecMMX, 1, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(ManualVecMMX, 64, std::uint8_t);
+#endif
 
-  {
-    int i = 0;
-    auto* ptr = mat;
-    for (; i <= ncells - nlanes; i += nlanes) {
-      _mm256_storeu_si256((__m256i*)ptr, zeros);
-      ptr += nlanes;
-    }
-    for (; i < ncells; ++i) {
-      *ptr = 0;
-      ++ptr;
-    }
+SIMPLE_MAT_BENCHMARK(ManualVec<simd::Isa::Scalar>, 64, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(ManualVec<simd::Isa::SSE42>, 1, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(ManualVec<simd::Isa::SSE42>, 16, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(ManualVec<simd::Isa::AVX2>, 1, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(ManualVec<simd::Isa::AVX2>, 32, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(ManualVec<simd::Isa::AVX512>, 1, std::uint8_t);
+SIMPLE_MAT_BENCHMARK(ManualVec<simd::Isa::AVX512>, 64, std::uint8_t);
+
+SIMPLE_MAT_BENCHMARK(Dispatched, 64, std::uint8_t);
+
+// dst = src + 42 into a second buffer with cached or streaming stores.  The
+// crossover sits near the LLC size, which is where Store::Auto switches (see
+// simd::streaming_threshold()).
+template <simd::Isa I, simd::Store S>
+static void AddTo(benchmark::State& state) {
+  auto const* kernels = simd::kernels(I);
+  if (!kernels) {
+    state.SkipWithError("ISA not supported on this host");
+    for (auto _ : state) {}
+    return;
   }
 
-  for (auto _ : state) {
-    int i = 0;
-    auto* ptr = mat;
-    for (; i <= ncells - nlanes; i += nlanes) {
-      auto vec = _mm256_loadu_si256((const __m256i*)ptr);
-      vec = _mm256_add_epi8(vec, const42);
-      _mm256_storeu_si256((__m256i*)ptr, vec);
-      ptr += nlanes;
-    }
-    for (; i < ncells; ++i) {
-      *ptr += 42;
-      ++ptr;
-    }
+  auto const nbytes = static_cast<std::size_t>(state.range(0));
 
-    benchmark::DoNotOptimize(mat);
-    benchmark::ClobberMemory();
-  }
-}
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC pop_options
-#endif
-BENCHMARK(ManualVecAVX2);
-
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC push_options
-# pragma GCC optimize ("O2")
-# pragma GCC target ("sse,sse2,sse3,ssse3,sse4,popcnt,abm,mmx,avx,avx2,tune=skylake")
-#endif
-static void ManualVecAVX2Aligned(benchmark::State& state) {
-  __m256i zeros = _mm256_setzero_si256();
-  __m256i const42 = _mm256_set1_epi8(42);
-
-  auto pmat = aligned_unique_ptr(rows * cols, std::align_val_t{32});
-  auto* mat = pmat.get();
-  assume_aligned(mat, 32);
-
-  constexpr int nlanes = 32;
-  auto const ncells = cols * rows;
-
-  {
-    int i = 0;
-    auto* ptr = mat;
-    for (; i <= ncells - nlanes; i += nlanes) {
-      _mm256_store_si256((__m256i*)ptr, zeros);
-      ptr += nlanes;
-    }
-    for (; i < ncells; ++i) {
-      *ptr = 0;
-      ++ptr;
-    }
-  }
+  arena().reset();
+  auto* src = arena().allocate<std::uint8_t>(nbytes);
+  auto* dst = arena().allocate<std::uint8_t>(nbytes);
+  std::memset(src, 0, nbytes);
+  std::memset(dst, 0, nbytes);
 
+  perf::BenchmarkCounters counters(state);
   for (auto _ : state) {
-    int i = 0;
-    auto* ptr = mat;
-    for (; i <= ncells - nlanes; i += nlanes) {
-      auto vec = _mm256_load_si256((const __m256i*)ptr);
-      vec = _mm256_add_epi8(vec, const42);
-      _mm256_store_si256((__m256i*)ptr, vec);
-      ptr += nlanes;
-    }
-    for (; i < ncells; ++i) {
-      *ptr += 42;
-      ++ptr;
-    }
+    kernels->add_k(dst, src, nbytes, 42, S);
 
-    benchmark::DoNotOptimize(mat);
+    benchmark::DoNotOptimize(dst);
     benchmark::ClobberMemory();
   }
-}
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC pop_options
-#endif
-BENCHMARK(ManualVecAVX2Aligned);
 
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC push_options
-# pragma GCC optimize ("O2")
-# pragma GCC target ("sse,sse2,sse3,ssse3,sse4,popcnt,abm,mmx,tune=skylake")
-#endif
-static void ManualVecSSE(benchmark::State& state) {
-  __m128i zeros = _mm_setzero_si128();
-  __m128i const42 = _mm_set1_epi8(42);
+  state.SetBytesProcessed(state.iterations() * nbytes * 2);
+}
 
-  auto  pmat = std::make_unique<std::uint8_t[]>(rows * cols);
-  auto* mat = pmat.get();
+#define ADD_TO_BENCHMARK(...)                    \
+  BENCHMARK_TEMPLATE(AddTo, __VA_ARGS__)         \
+  ->RangeMultiplier(4)                           \
+  ->Ranges({{4 << 10, 1 << 30}})
+
+ADD_TO_BENCHMARK(simd::Isa::AVX2, simd::Store::Cached);
+ADD_TO_BENCHMARK(simd::Isa::AVX2, simd::Store::Streaming);
+ADD_TO_BENCHMARK(simd::Isa::AVX512, simd::Store::Cached);
+ADD_TO_BENCHMARK(simd::Isa::AVX512, simd::Store::Streaming);
+ADD_TO_BENCHMARK(simd::Isa::AVX512, simd::Store::Auto);
+
+enum class WideOp { Adds, Fma, Clamp };
+
+// The wider element kernels in place, per ISA; Isa::Scalar is the
+// auto-vectorised fallback.  Each op keeps the values bounded (saturating,
+// converging to 2, or clamped) so floats never go denormal mid-run.
+template <WideOp Op, simd::Isa I, typename T>
+static void Wide(benchmark::State& state) {
+  auto const* kernels = simd::element_kernels<T>(I);
+  if (!kernels) {
+    state.SkipWithError("ISA not supported on this host");
+    for (auto _ : state) {}
+    return;
+  }
 
-  constexpr int nlanes = 16;
-  auto const ncells = cols * rows;
+  auto const nbytes = static_cast<std::size_t>(state.range(0));
+  auto const n = nbytes / sizeof(T);
 
-  {
-    int i = 0;
-    auto* ptr = mat;
-    for (; i <= ncells - nlanes; i += nlanes) {
-      _mm_storeu_si128((__m128i*)ptr, zeros);
-      ptr += nlanes;
-    }
-    for (; i < ncells; ++i) {
-      *ptr = 0;
-      ++ptr;
-    }
-  }
+  arena().reset();
+  auto* mat = arena().allocate<T>(n);
+  std::fill_n(mat, n, T(1));
 
+  perf::BenchmarkCounters counters(state);
   for (auto _ : state) {
-    int i = 0;
-    auto* ptr = mat;
-    for (; i <= ncells - nlanes; i += nlanes) {
-      auto vec = _mm_loadu_si128((const __m128i*)ptr);
-      vec = _mm_add_epi8(vec, const42);
-      _mm_storeu_si128((__m128i*)ptr, vec);
-      ptr += nlanes;
-    }
-    for (; i < ncells; ++i) {
-      *ptr += 42;
-      ++ptr;
+    switch (Op) {
+    case WideOp::Adds:
+      kernels->adds_k(mat, mat, n, T(1), simd::Store::Auto);
+      break;
+    case WideOp::Fma:
+      kernels->fma(mat, mat, n, std::is_floating_point_v<T> ? T(0.5) : T(3),
+                   T(1), simd::Store::Auto);
+      break;
+    case WideOp::Clamp:
+      kernels->clamp(mat, mat, n, T(2), T(100), simd::Store::Auto);
+      break;
     }
 
     benchmark::DoNotOptimize(mat);
     benchmark::ClobberMemory();
   }
+
+  state.SetBytesProcessed(state.iterations() * n * sizeof(T) * 2);
 }
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC pop_options
-#endif
-BENCHMARK(ManualVecSSE);
 
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC push_options
-# pragma GCC optimize ("O2")
-# pragma GCC target ("sse,sse2,sse3,ssse3,sse4,popcnt,abm,mmx,tune=skylake")
-#endif
-static void ManualVecSSEAligned(benchmark::State& state) {
-  __m128i zeros = _mm_setzero_si128();
-  __m128i const42 = _mm_set1_epi8(42);
-
-  auto pmat = aligned_unique_ptr(rows * cols, std::align_val_t{16});
-  auto* mat = pmat.get();
-  assume_aligned(mat, 16);
-
-  constexpr int nlanes = 16;
-  auto const ncells = cols * rows;
-
-  {
-    int i = 0;
-    auto* ptr = mat;
-    for (; i <= ncells - nlanes; i += nlanes) {
-      _mm_store_si128((__m128i*)ptr, zeros);
-      ptr += nlanes;
-    }
-    for (; i < ncells; ++i) {
-      *ptr = 0;
-      ++ptr;
+#define WIDE_BENCHMARK(op, T)                                     \
+  BENCHMARK_TEMPLATE(Wide, op, simd::Isa::Scalar, T)              \
+  ->RangeMultiplier(16)->Ranges({{4 << 10, 1 << 30}});            \
+  BENCHMARK_TEMPLATE(Wide, op, simd::Isa::SSE42, T)               \
+  ->RangeMultiplier(16)->Ranges({{4 << 10, 1 << 30}});            \
+  BENCHMARK_TEMPLATE(Wide, op, simd::Isa::AVX2, T)                \
+  ->RangeMultiplier(16)->Ranges({{4 << 10, 1 << 30}});            \
+  BENCHMARK_TEMPLATE(Wide, op, simd::Isa::AVX512, T)              \
+  ->RangeMultiplier(16)->Ranges({{4 << 10, 1 << 30}})
+
+WIDE_BENCHMARK(WideOp::Adds, std::uint16_t);
+WIDE_BENCHMARK(WideOp::Adds, std::int32_t);
+WIDE_BENCHMARK(WideOp::Adds, float);
+WIDE_BENCHMARK(WideOp::Adds, double);
+WIDE_BENCHMARK(WideOp::Fma, std::uint16_t);
+WIDE_BENCHMARK(WideOp::Fma, std::int32_t);
+WIDE_BENCHMARK(WideOp::Fma, float);
+WIDE_BENCHMARK(WideOp::Fma, double);
+WIDE_BENCHMARK(WideOp::Clamp, std::uint16_t);
+WIDE_BENCHMARK(WideOp::Clamp, std::int32_t);
+WIDE_BENCHMARK(WideOp::Clamp, float);
+WIDE_BENCHMARK(WideOp::Clamp, double);
+
+// The reference loops the frame kernels are measured against: a row-major
+// read, column-major write transpose and a direct K x K convolution, both
+// left to the compiler.
+struct NaiveFrame {
+  static bool supported() { return true; }
+
+  static void transpose(std::uint8_t* dst, std::uint8_t const* src,
+                        std::size_t rows, std::size_t cols) {
+    for (std::size_t r = 0; r < rows; ++r) {
+      for (std::size_t c = 0; c < cols; ++c)
+        dst[c * rows + r] = src[r * cols + c];
     }
   }
 
-  for (auto _ : state) {
-    int i = 0;
-    auto* ptr = mat;
-    for (; i <= ncells - nlanes; i += nlanes) {
-      auto vec = _mm_load_si128((const __m128i*)ptr);
-      vec = _mm_add_epi8(vec, const42);
-      _mm_store_si128((__m128i*)ptr, vec);
-      ptr += nlanes;
-    }
-    for (; i < ncells; ++i) {
-      *ptr += 42;
-      ++ptr;
+  template <std::size_t K>
+  static void convolve(std::uint8_t* dst, std::uint8_t const* src,
+                       std::size_t rows, std::size_t cols,
+                       std::int16_t const (&kx)[K], std::int16_t const (&ky)[K],
+                       unsigned shift) {
+    auto const r = static_cast<std::ptrdiff_t>(K / 2);
+    auto const clamp = [](std::ptrdiff_t i, std::size_t n) {
+      return static_cast<std::size_t>(
+          std::clamp<std::ptrdiff_t>(i, 0, static_cast<std::ptrdiff_t>(n) - 1));
+    };
+    for (std::size_t y = 0; y < rows; ++y) {
+      for (std::size_t x = 0; x < cols; ++x) {
+        std::int32_t sum = shift ? 1 << (shift - 1) : 0;
+        for (std::size_t i = 0; i < K; ++i) {
+          auto const* row = src + clamp(y + i - r, rows) * cols;
+          for (std::size_t j = 0; j < K; ++j)
+            sum += ky[i] * kx[j] * row[clamp(x + j - r, cols)];
+        }
+        dst[y * cols + x] =
+            static_cast<std::uint8_t>(std::clamp(sum >> shift, 0, 255));
+      }
     }
-
-    benchmark::DoNotOptimize(mat);
-    benchmark::ClobberMemory();
   }
-}
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC pop_options
-#endif
-BENCHMARK(ManualVecSSEAligned);
-
-#if !defined(_MSC_VER)
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC push_options
-# pragma GCC optimize ("O2")
-# pragma GCC target ("mmx,tune=skylake")
-#endif
-static void ManualVecMMX(benchmark::State& state) {
-  __m64 zeros = _mm_setzero_si64();
-  __m64 const42 = _mm_set1_pi8(42);
+};
 
-  auto  pmat = std::make_unique<std::uint8_t[]>(rows * cols);
-  auto* mat = pmat.get();
+template <simd::Isa I>
+struct ManualFrame {
+  static bool supported() { return simd::isa_supported(I); }
 
-  constexpr int nlanes = 8;
-  auto const ncells = cols * rows;
+  static void transpose(std::uint8_t* dst, std::uint8_t const* src,
+                        std::size_t rows, std::size_t cols) {
+    simd::frame_kernels(I)->transpose(dst, rows, src, cols, rows, cols);
+  }
 
-  int i = 0;
-  auto* ptr = mat;
-  for (; i <= ncells - nlanes; i += nlanes) {
-    *reinterpret_cast<std::uint64_t*>(ptr) = _m_to_int64(zeros);
-    ptr += nlanes;
+  template <std::size_t K>
+  static void convolve(std::uint8_t* dst, std::uint8_t const* src,
+                       std::size_t rows, std::size_t cols,
+                       std::int16_t const (&kx)[K], std::int16_t const (&ky)[K],
+                       unsigned shift) {
+    auto const* kernels = simd::frame_kernels(I);
+    (K == 3 ? kernels->convolve3 : kernels->convolve5)(
+        dst, cols, src, cols, rows, cols, kx, ky, shift);
   }
-  for (; i < ncells; ++i) {
-    *ptr = 0;
-    ++ptr;
+};
+
+static void FrameArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"rows", "cols"});
+  b->Args({1080, 1920});
+  b->Args({2160, 3840});
+}
+
+// Bytes processed count the frame read and written once.
+template <typename Kernel>
+static void Transpose(benchmark::State& state) {
+  if (!Kernel::supported()) {
+    state.SkipWithError("ISA not supported on this host");
+    for (auto _ : state) {}
+    return;
   }
 
+  auto const rows = static_cast<std::size_t>(state.range(0));
+  auto const cols = static_cast<std::size_t>(state.range(1));
+  arena().reset();
+  auto* src = arena().allocate<std::uint8_t>(rows * cols);
+  auto* dst = arena().allocate<std::uint8_t>(rows * cols);
+  std::memset(src, 1, rows * cols);
+  std::memset(dst, 0, rows * cols);
+
+  perf::BenchmarkCounters counters(state);
   for (auto _ : state) {
-    int i = 0;
-    auto* ptr = mat;
-    for (; i <= ncells - nlanes; i += nlanes) {
-      auto vec = _m_from_int64(*(const std::uint64_t*)ptr);
-      vec = _mm_add_pi8(vec, const42);
-      *reinterpret_cast<std::uint64_t*>(ptr) = _m_to_int64(vec);
-      ptr += nlanes;
-    }
-    for (; i < ncells; ++i) {
-      *ptr += 42;
-      ++ptr;
-    }
+    Kernel::transpose(dst, src, rows, cols);
 
-    benchmark::DoNotOptimize(mat);
+    benchmark::DoNotOptimize(dst);
     benchmark::ClobberMemory();
   }
 
-  _mm_empty();
+  state.SetBytesProcessed(state.iterations() * rows * cols * 2);
 }
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC pop_options
-#endif
-BENCHMARK(ManualVecMMX);
-#endif
 
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC push_options
-# pragma GCC optimize ("O2")
-#endif
-static void NoVec(benchmark::State& state) {
-  auto const ncells = rows * cols;
-
-  auto  pmat = std::make_unique<std::uint8_t[]>(rows * cols);
-  auto* mat = pmat.get();
-
-  {
-    auto* ptr = mat;
-    for (int i = 0; i < ncells; ++i) {
-      *(ptr++) = 0;
-    }
+BENCHMARK_TEMPLATE(Transpose, NaiveFrame)->Apply(FrameArgs);
+BENCHMARK_TEMPLATE(Transpose, ManualFrame<simd::Isa::Scalar>)->Apply(FrameArgs);
+BENCHMARK_TEMPLATE(Transpose, ManualFrame<simd::Isa::SSE42>)->Apply(FrameArgs);
+BENCHMARK_TEMPLATE(Transpose, ManualFrame<simd::Isa::AVX2>)->Apply(FrameArgs);
+BENCHMARK_TEMPLATE(Transpose, ManualFrame<simd::Isa::AVX512>)->Apply(FrameArgs);
+
+// A binomial (Gaussian) blur: 3x3 [1 2 1] and 5x5 [1 4 6 4 1] taps.
+template <typename Kernel, std::size_t K>
+static void Convolve(benchmark::State& state) {
+  if (!Kernel::supported()) {
+    state.SkipWithError("ISA not supported on this host");
+    for (auto _ : state) {}
+    return;
   }
 
+  static constexpr std::int16_t taps3[3] = {1, 2, 1};
+  static constexpr std::int16_t taps5[5] = {1, 4, 6, 4, 1};
+  auto const& taps = [] () -> std::int16_t const (&)[K] {
+    if constexpr (K == 3)
+      return taps3;
+    else
+      return taps5;
+  }();
+  unsigned const shift = K == 3 ? 4 : 8;
+
+  auto const rows = static_cast<std::size_t>(state.range(0));
+  auto const cols = static_cast<std::size_t>(state.range(1));
+  arena().reset();
+  auto* src = arena().allocate<std::uint8_t>(rows * cols);
+  auto* dst = arena().allocate<std::uint8_t>(rows * cols);
+  for (std::size_t i = 0; i < rows * cols; ++i)
+    src[i] = static_cast<std::uint8_t>(i * 7);
+  std::memset(dst, 0, rows * cols);
+
+  perf::BenchmarkCounters counters(state);
   for (auto _ : state) {
-    auto* ptr = mat;
-    for (int i = 0; i < ncells; ++i) {
-      *(ptr++) += 42;
-    }
+    Kernel::convolve(dst, src, rows, cols, taps, taps, shift);
 
-    benchmark::DoNotOptimize(mat);
+    benchmark::DoNotOptimize(dst);
     benchmark::ClobberMemory();
   }
-}
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC pop_options
-#endif
-BENCHMARK(NoVec);
 
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC push_options
-# pragma GCC optimize ("O2")
-#endif
-static void NoVecAligned32(benchmark::State& state) {
-  auto const ncells = rows * cols;
-
-  auto pmat = aligned_unique_ptr(rows * cols, std::align_val_t{32});
-  auto* mat = pmat.get();
-  assume_aligned(mat, 32);
+  state.SetBytesProcessed(state.iterations() * rows * cols * 2);
+}
 
-  {
-    auto* ptr = mat;
-    for (int i = 0; i < ncells; ++i) {
-      *(ptr++) = 0;
+#define CONVOLVE_BENCHMARK(K)                                                 \
+  BENCHMARK_TEMPLATE(Convolve, NaiveFrame, K)->Apply(FrameArgs);              \
+  BENCHMARK_TEMPLATE(Convolve, ManualFrame<simd::Isa::Scalar>, K)             \
+  ->Apply(FrameArgs);                                                         \
+  BENCHMARK_TEMPLATE(Convolve, ManualFrame<simd::Isa::SSE42>, K)              \
+  ->Apply(FrameArgs);                                                         \
+  BENCHMARK_TEMPLATE(Convolve, ManualFrame<simd::Isa::AVX2>, K)               \
+  ->Apply(FrameArgs);                                                         \
+  BENCHMARK_TEMPLATE(Convolve, ManualFrame<simd::Isa::AVX512>, K)             \
+  ->Apply(FrameArgs)
+
+CONVOLVE_BENCHMARK(3);
+CONVOLVE_BENCHMARK(5);
+
+// Dispatched add over 4K and 8K frames split into bands across a persistent
+// pool; threads:0 runs on the benchmark thread without the pool.  Bytes
+// count both the load and the store of every cell.
+static void ParallelAdd(benchmark::State& state) {
+  auto const ncells = static_cast<std::size_t>(state.range(0) * state.range(1));
+  auto const nthreads = static_cast<unsigned>(state.range(2));
+
+  auto const& kernels = simd::kernels();
+
+  if (nthreads == 0) {
+    arena().reset();
+    auto* mat = arena().allocate<std::uint8_t>(ncells);
+    std::memset(mat, 0, ncells);
+    perf::BenchmarkCounters counters(state);
+    for (auto _ : state) {
+      kernels.add_k(mat, mat, ncells, 42, simd::Store::Auto);
+
+      benchmark::DoNotOptimize(mat);
+      benchmark::ClobberMemory();
+    }
+  } else {
+    // A private arena, first touched band by band by the pool's workers.
+    simd::ThreadPool pool(nthreads);
+    simd::Arena local(ncells, simd::Arena::Pages::Huge, &pool);
+    auto* mat = local.allocate<std::uint8_t>(ncells);
+    // Counts this thread only, which mostly waits on the workers.
+    perf::BenchmarkCounters counters(state);
+    for (auto _ : state) {
+      simd::parallel(pool, kernels.add_k, mat, mat, ncells, 42);
+
+      benchmark::DoNotOptimize(mat);
+      benchmark::ClobberMemory();
     }
   }
 
-  for (auto _ : state) {
-    auto* ptr = mat;
-    for (int i = 0; i < ncells; ++i) {
-      *(ptr++) += 42;
+  state.SetBytesProcessed(state.iterations() * ncells * 2);
+}
+static void ParallelAddArgs(benchmark::internal::Benchmark* b) {
+  auto const max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  for (auto const& frame : {std::pair{2160, 3840}, std::pair{4320, 7680}}) {
+    b->Args({frame.first, frame.second, 0});
+    for (unsigned n = 1;; n = std::min(n * 2, max_threads)) {
+      b->Args({frame.first, frame.second, n});
+      if (n == max_threads)
+        break;
     }
-
-    benchmark::DoNotOptimize(mat);
-    benchmark::ClobberMemory();
   }
 }
-#if defined(__GNUC__) && !defined(__clang__)
-# pragma GCC pop_options
-#endif
-BENCHMARK(NoVecAligned32);
+BENCHMARK(ParallelAdd)
+->ArgNames({"rows", "cols", "threads"})
+->Apply(ParallelAddArgs)
+->UseRealTime();
 
 BENCHMARK_MAIN();
@@ -0,0 +1,53 @@
+#pragma once
+
+// Compiling code for an instruction set other than the global -march, on
+// GCC.  Everything here expands to nothing on other compilers, which build
+// only what -march (or, for MSVC, /arch) enables; SIMD_HAS_TARGET says
+// which case this is.
+//
+// SIMD_TARGET_PUSH("avx2,fma") ... SIMD_TARGET_POP() compiles every function
+// declared in between, including the templates instantiated from it, for
+// that target with `#pragma GCC target`.  The standard and intrinsic headers
+// must come before the push.
+//
+// The ISA units use a region rather than a target attribute on each kernel
+// template.  Their kernels are the templates of the *_detail.hxx headers,
+// instantiated with the unit's Vec<T>.  GCC inlines a helper into an
+// attributed function only when the helper has the same target, so every
+// helper template and every Vec<T> operation would need the attribute as
+// well.  A region covers them all.
+//
+// SIMD_TARGET("avx2,fma") does the same for one function.  Feature lists add
+// to the global -march; "arch=x86-64,avx2,fma" replaces it, which is what a
+// benchmark comparing ISAs on a -march=native build wants.
+//
+// SIMD_TARGET_CLONES compiles one copy of a function per ISA level the simd
+// library knows (AVX-512BW, AVX2, SSE4.2, baseline) plus an ifunc resolver.
+// The dynamic loader runs the resolver once, so calls go straight to the
+// best clone with no per-call dispatch.
+
+#define SIMD_PRAGMA(x) _Pragma(#x)
+
+#if defined(__GNUC__) && !defined(__clang__)
+# define SIMD_HAS_TARGET 1
+# define SIMD_TARGET_PUSH(isa)                                           \
+  _Pragma("GCC push_options")                                           \
+  SIMD_PRAGMA(GCC target(isa))
+# define SIMD_TARGET_POP() _Pragma("GCC pop_options")
+# define SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+# define SIMD_HAS_TARGET 0
+# define SIMD_TARGET_PUSH(isa)
+# define SIMD_TARGET_POP()
+# define SIMD_TARGET(isa)
+#endif
+
+// Clones need ifunc support from the toolchain and the loader.  GCC 12
+// resolves AVX-512BW only through an arch= level.
+#if SIMD_HAS_TARGET && defined(__x86_64__) && defined(__linux__)
+# define SIMD_TARGET_CLONES                                              \
+  __attribute__((target_clones("arch=x86-64-v4", "arch=x86-64-v3",      \
+                               "arch=x86-64-v2", "default")))
+#else
+# define SIMD_TARGET_CLONES
+#endif
@@ -0,0 +1,102 @@
+#include <algorithm>
+
+#if defined(__linux__)
+# include <pthread.h>
+# include <sched.h>
+#endif
+
+#include "thread_pool.hxx"
+
+namespace simd {
+
+namespace {
+
+std::vector<unsigned> allowed_cpus() {
+  std::vector<unsigned> cpus;
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set))
+        cpus.push_back(cpu);
+    }
+  }
+#endif
+  return cpus;
+}
+
+void pin(std::thread& thread, unsigned cpu) {
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  // Best effort: an unpinned worker is slower on NUMA hosts, not wrong.
+  pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+  (void)thread;
+  (void)cpu;
+#endif
+}
+
+}  // namespace
+
+ThreadPool::ThreadPool(unsigned nthreads) {
+  nthreads = std::max(nthreads, 1u);
+  auto const cpus = allowed_cpus();
+
+  workers_.reserve(nthreads);
+  for (unsigned i = 0; i < nthreads; ++i) {
+    workers_.emplace_back([this, i] { work(i); });
+    if (!cpus.empty())
+      pin(workers_.back(), cpus[i % cpus.size()]);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto& worker : workers_)
+    worker.join();
+}
+
+void ThreadPool::run_job(void (*fn)(void*, unsigned), void* ctx) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // Another caller's job may still be running.
+  done_.wait(lock, [this] { return pending_ == 0; });
+
+  job_ = Job{fn, ctx};
+  pending_ = size();
+  ++generation_;
+  wake_.notify_all();
+
+  done_.wait(lock, [this] { return pending_ == 0; });
+}
+
+void ThreadPool::work(unsigned worker) {
+  std::uint64_t seen = 0;
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_)
+        return;
+      seen = generation_;
+      job = job_;
+    }
+
+    job.fn(job.ctx, worker);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--pending_ == 0)
+        done_.notify_all();
+    }
+  }
+}
+
+}  // namespace simd
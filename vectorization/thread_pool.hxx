@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace simd {
+
+// A fixed set of workers, each pinned to one CPU where the OS allows it.
+// run() hands the same job to every worker and blocks until all of them
+// return.  Worker i always runs on the same CPU, so data first touched by
+// worker i stays on that CPU's NUMA node for later jobs.
+class ThreadPool {
+public:
+  explicit ThreadPool(unsigned nthreads = std::thread::hardware_concurrency());
+  ~ThreadPool();
+
+  ThreadPool(ThreadPool const&) = delete;
+  ThreadPool& operator = (ThreadPool const&) = delete;
+
+  unsigned size() const noexcept {
+    return static_cast<unsigned>(workers_.size());
+  }
+
+  // Calls fn(worker) once per worker.  fn must not throw.
+  template <typename Fn>
+  void run(Fn&& fn) {
+    using F = std::remove_reference_t<Fn>;
+    run_job([](void* ctx, unsigned worker) {
+      (*static_cast<F*>(ctx))(worker);
+    }, &fn);
+  }
+
+private:
+  struct Job {
+    void (*fn)(void*, unsigned) = nullptr;
+    void* ctx = nullptr;
+  };
+
+  void run_job(void (*fn)(void*, unsigned), void* ctx);
+  void work(unsigned worker);
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  Job job_;
+  std::uint64_t generation_ = 0;
+  unsigned pending_ = 0;
+  bool stop_ = false;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace simd
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+#include "thread_pool.hxx"
+
+namespace simd {
+
+namespace detail {
+
+// A worker's share of the tasks, [begin, end) packed into one word so that
+// the owner taking the front and a thief taking the back agree by CAS.
+struct alignas(64) TaskRange {
+  std::atomic<std::uint64_t> range{0};
+
+  static constexpr std::uint64_t pack(std::uint32_t begin, std::uint32_t end) noexcept {
+    return std::uint64_t{end} << 32 | begin;
+  }
+  static constexpr std::uint32_t begin(std::uint64_t range) noexcept {
+    return static_cast<std::uint32_t>(range);
+  }
+  static constexpr std::uint32_t end(std::uint64_t range) noexcept {
+    return static_cast<std::uint32_t>(range >> 32);
+  }
+};
+
+}  // namespace detail
+
+// Calls fn(worker, i) once for each i in [0, n) on pool's workers, for
+// tasks of uneven or unknown cost.  Each worker starts on its own slice of
+// [0, n) and takes tasks from the front of it; one that runs dry takes the
+// back half of the largest slice left and carries on with that, until
+// there is nothing left to take.  fn must not throw.
+template <typename Fn>
+void for_each_stealing(ThreadPool& pool, std::size_t n, Fn&& fn) {
+  using detail::TaskRange;
+  assert(n <= std::numeric_limits<std::uint32_t>::max());
+
+  auto const nworkers = pool.size();
+  auto const ranges = std::make_unique<TaskRange[]>(nworkers);
+  for (unsigned w = 0; w < nworkers; ++w) {
+    ranges[w].range.store(TaskRange::pack(
+      static_cast<std::uint32_t>(n * w / nworkers),
+      static_cast<std::uint32_t>(n * (w + 1) / nworkers)),
+      std::memory_order_relaxed);
+  }
+
+  pool.run([&](unsigned worker) {
+    auto& own = ranges[worker].range;
+    for (;;) {
+      auto range = own.load(std::memory_order_acquire);
+      while (TaskRange::begin(range) < TaskRange::end(range)) {
+        auto const task = TaskRange::begin(range);
+        if (own.compare_exchange_weak(range, TaskRange::pack(task + 1, TaskRange::end(range)),
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+          fn(worker, std::size_t{task});
+          range = own.load(std::memory_order_acquire);
+        }
+      }
+
+      // Nobody steals from an empty slice, so own is ours to refill.
+      bool stolen = false;
+      while (!stolen) {
+        unsigned victim = nworkers;
+        std::uint64_t victim_range = 0;
+        std::uint32_t most = 0;
+        for (unsigned w = 0; w < nworkers; ++w) {
+          auto const r = ranges[w].range.load(std::memory_order_acquire);
+          if (TaskRange::end(r) - TaskRange::begin(r) > most) {
+            victim = w;
+            victim_range = r;
+            most = TaskRange::end(r) - TaskRange::begin(r);
+          }
+        }
+        if (victim == nworkers)
+          return;
+
+        auto const begin = TaskRange::begin(victim_range);
+        auto const end = TaskRange::end(victim_range);
+        auto const mid = begin + (end - begin) / 2;
+        stolen = ranges[victim].range.compare_exchange_strong(
+          victim_range, TaskRange::pack(begin, mid),
+          std::memory_order_acq_rel, std::memory_order_acquire);
+        if (stolen)
+          own.store(TaskRange::pack(mid, end), std::memory_order_release);
+      }
+    }
+  });
+}
+
+}  // namespace simd